@@ -18,5 +18,18 @@
 #define ASYNC_CONFIG_H
 
 #define ASYNC_PROGRESS_WIDGET_UPDATE_TIMEOUT 200
+#define ASYNC_TASK_SCOPE_UPDATE_TIMEOUT 100
+#define ASYNC_BLOCKED_WORKER_TIMEOUT 50
+#define ASYNC_BLOCKING_POOL_MAX_THREADS 64
+#define ASYNC_INLINE_TASK_MAX_DURATION_USEC 100
+#define ASYNC_DEDICATED_THREAD_MIN_DURATION_USEC 1000000
+#define ASYNC_AUTO_TUNE_INTERVAL 500
+#define ASYNC_PREFETCH_PRIORITY -100
+#define ASYNC_COLD_STORAGE_IDLE_TIMEOUT 60000
+#define ASYNC_COLD_STORAGE_SPILL_TIMEOUT 300000
+#define ASYNC_SLOW_EMIT_THRESHOLD_USEC 10000
+#define ASYNC_SLOW_EMIT_MAX_RECORDS 20
+#define ASYNC_GUI_BLOCKING_THRESHOLD_MSEC 16
+#define ASYNC_GUI_BLOCKING_MAX_RECORDS 20
 
 #endif // ASYNC_CONFIG_H
@@ -10,6 +10,17 @@ QT       -= gui
 
 SOURCES += \
     values/AsyncValueBase.cpp \
+    values/AsyncTransaction.cpp \
+    values/AsyncTaskScope.cpp \
+    values/AsyncThreadPool.cpp \
+    values/AsyncNumaPools.cpp \
+    values/AsyncWorkStats.cpp \
+    values/AsyncStartupLoader.cpp \
+    values/AsyncColdStorage.cpp \
+    values/AsyncSpillFile.cpp \
+    values/AsyncEmitProfiler.cpp \
+    values/AsyncBlockingDetector.cpp \
+    values/AsyncProfiler.cpp \
     widgets/AsyncWidgetProxy.cpp \
     widgets/AsyncWidgetError.cpp \
     third_party/QtWaitingSpinner/waitingspinnerwidget.cpp \
@@ -35,6 +46,21 @@ HEADERS += \
     values/AsyncTrackErrorsPolicy.h \
     values/AsyncValueRunThread.h \
     values/AsyncValueRunable.h \
-    values/AsyncValueRunNetwork.h
+    values/AsyncValueRunNetwork.h \
+    values/AsyncTransaction.h \
+    values/AsyncValueMulticast.h \
+    values/AsyncComparePolicy.h \
+    values/AsyncProjection.h \
+    values/AsyncTaskScope.h \
+    values/AsyncThreadPool.h \
+    values/AsyncNumaPools.h \
+    values/AsyncWorkStats.h \
+    values/AsyncPrefetchCache.h \
+    values/AsyncStartupLoader.h \
+    values/AsyncColdStorage.h \
+    values/AsyncSpillFile.h \
+    values/AsyncEmitProfiler.h \
+    values/AsyncBlockingDetector.h \
+    values/AsyncProfiler.h
 	
 DEFINES += QT_DEPRECATED_WARNINGS
@@ -0,0 +1,108 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncBlockingDetector.h"
+#include "AsyncValueBase.h"
+#include <QCoreApplication>
+#include <QDebug>
+
+static thread_local AsyncBlockingDetector::Site* currentSite = nullptr;
+
+static bool isGuiThread()
+{
+    auto app = QCoreApplication::instance();
+    return app && app->thread() == QThread::currentThread();
+}
+
+void AsyncBlockingDetector::record(const AsyncValueBase* value, const char* api, const char* file, int line, quint64 owner, qint64 duration)
+{
+    if (!m_blockings.isSlow(duration))
+        return;
+
+    Blocking blocking;
+    blocking.value = asyncObjectName(value);
+    blocking.api = QString::fromLatin1(api);
+    if (file)
+        blocking.site = QString("%1:%2").arg(QString::fromLocal8Bit(file)).arg(line);
+    blocking.owner = owner;
+    blocking.duration = duration;
+
+    qWarning() << "GUI thread blocked:" << blocking.api << blocking.value << blocking.site
+               << "owner" << owner << "for" << duration << "msec";
+
+    m_blockings.insert(std::move(blocking));
+}
+
+QJsonObject AsyncBlockingDetector::toJson() const
+{
+    QJsonObject result;
+
+    result.insert("blockings", m_blockings.toJson([](const Blocking& blocking) {
+        QJsonObject item;
+        item.insert("value", blocking.value);
+        item.insert("api", blocking.api);
+        item.insert("site", blocking.site);
+        item.insert("owner", static_cast<double>(blocking.owner));
+        item.insert("duration", static_cast<double>(blocking.duration));
+        return item;
+    }));
+
+    return result;
+}
+
+AsyncBlockingDetector::Block::Block(const AsyncValueBase* value, const char* api, AsyncBlockingDetector* detector)
+    : m_detector(detector),
+      m_value(value),
+      m_api(api),
+      m_isEnabled(api && detector->isEnabled() && isGuiThread())
+{
+    if (!m_isEnabled)
+        return;
+
+    // waiter is blocked by the calculation rather than by the write lock
+    auto owner = value->m_writeLockOwner.loadAcquire();
+    if (!owner)
+        owner = value->m_calculationThread.loadAcquire();
+
+    m_owner = static_cast<quint64>(reinterpret_cast<quintptr>(owner));
+
+    if (currentSite)
+    {
+        m_file = currentSite->m_file;
+        m_line = currentSite->m_line;
+    }
+
+    m_timer.start();
+}
+
+AsyncBlockingDetector::Block::~Block()
+{
+    if (m_isEnabled)
+        m_detector->record(m_value, m_api, m_file, m_line, m_owner, m_timer.elapsed());
+}
+
+AsyncBlockingDetector::Site::Site(const char* file, int line)
+    : m_file(file),
+      m_line(line),
+      m_prevSite(currentSite)
+{
+    currentSite = this;
+}
+
+AsyncBlockingDetector::Site::~Site()
+{
+    currentSite = m_prevSite;
+}
@@ -0,0 +1,113 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_BLOCKING_DETECTOR_H
+#define ASYNC_BLOCKING_DETECTOR_H
+
+#include "../Config.h"
+#include "AsyncProfiler.h"
+#include <QString>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <vector>
+
+class AsyncValueBase;
+
+// measures how long the GUI thread is blocked on async value locks and waits
+// blocks longer than the threshold are logged and the longest ones are kept
+// only calls that cannot take a lock immediately and restores of evicted values are measured
+// blocks are reported with API label and with the caller location marked by ASYNC_BLOCKING_SITE
+// NOTE: blocks are measured only if enabled
+class AsyncBlockingDetector : public AsyncProfiler<AsyncBlockingDetector>
+{
+    Q_DISABLE_COPY(AsyncBlockingDetector)
+
+public:
+    // durations are in milliseconds
+    struct Blocking
+    {
+        // value object name or type name
+        QString value;
+        // blocked call (e.g. "access" or "wait")
+        QString api;
+        // caller location ("file:line") or empty if it's not marked
+        QString site;
+        // id of the thread that held value's write lock or calculated the value when blocking started
+        quint64 owner = 0;
+        qint64 duration = 0;
+    };
+
+    AsyncBlockingDetector() = default;
+
+    qint64 threshold() const { return m_blockings.threshold(); }
+    void setThreshold(qint64 threshold) { m_blockings.setThreshold(threshold); }
+    void setMaxBlockings(int maxBlockings) { m_blockings.setMaxRecords(maxBlockings); }
+
+    void record(const AsyncValueBase* value, const char* api, const char* file, int line, quint64 owner, qint64 duration);
+
+    // returns blockings from the longest one
+    std::vector<Blocking> blockings() const { return m_blockings.records(); }
+    void reset() { m_blockings.reset(); }
+
+    // returns {"blockings": [{"value": "name", "api": "wait", "site": "main.cpp:10", "owner": 1234, "duration": 50}, ...]}
+    QJsonObject toJson() const;
+
+    // measures blocking of the GUI thread on the value
+    // nullptr api is not measured
+    class Block
+    {
+        Q_DISABLE_COPY(Block)
+
+    public:
+        Block(const AsyncValueBase* value, const char* api, AsyncBlockingDetector* detector = globalInstance());
+        ~Block();
+
+    private:
+        AsyncBlockingDetector* m_detector;
+        const AsyncValueBase* m_value;
+        const char* m_api;
+        const char* m_file = nullptr;
+        int m_line = 0;
+        bool m_isEnabled;
+        quint64 m_owner = 0;
+        QElapsedTimer m_timer;
+    };
+
+    // marks blocks of the current thread with the caller location until destruction
+    // use ASYNC_BLOCKING_SITE() macro
+    class Site
+    {
+        Q_DISABLE_COPY(Site)
+
+    public:
+        Site(const char* file, int line);
+        ~Site();
+
+    private:
+        friend class Block;
+
+        const char* m_file;
+        int m_line;
+        Site* m_prevSite;
+    };
+
+private:
+    AsyncSlowestRecords<Blocking> m_blockings { ASYNC_GUI_BLOCKING_THRESHOLD_MSEC, ASYNC_GUI_BLOCKING_MAX_RECORDS };
+};
+
+#define ASYNC_BLOCKING_SITE() AsyncBlockingDetector::Site asyncBlockingSite(__FILE__, __LINE__)
+
+#endif // ASYNC_BLOCKING_DETECTOR_H
@@ -0,0 +1,266 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncColdStorage.h"
+#include <QThread>
+#include <vector>
+
+class AsyncColdStorageThread : public QThread
+{
+public:
+    explicit AsyncColdStorageThread(AsyncColdStorage* storage)
+        : m_storage(storage)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        QMutexLocker locker(&m_storage->m_threadLock);
+
+        while (!m_storage->m_threadStop)
+        {
+            // compression takes storage and value locks
+            locker.unlock();
+            m_storage->compressIdleValues();
+            m_storage->spillIdleValues();
+            auto interval = qMax<qint64>(m_storage->checkInterval(), 1);
+            locker.relock();
+
+            if (!m_storage->m_threadStop)
+                m_storage->m_threadWakeUp.wait(&m_storage->m_threadLock, static_cast<unsigned long>(interval));
+        }
+    }
+
+private:
+    AsyncColdStorage* m_storage;
+};
+
+AsyncColdStorage::AsyncColdStorage(qint64 idleTimeout)
+    : m_idleTimeout(idleTimeout),
+      m_compress([](const QByteArray& data) { return qCompress(data); }),
+      m_uncompress([](const QByteArray& data) { return qUncompress(data); })
+{
+}
+
+AsyncColdStorage::~AsyncColdStorage()
+{
+    if (!m_thread)
+        return;
+
+    {
+        QMutexLocker locker(&m_threadLock);
+        m_threadStop = true;
+        m_threadWakeUp.wakeAll();
+    }
+
+    m_thread->wait();
+}
+
+qint64 AsyncColdStorage::idleTimeout() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_idleTimeout;
+}
+
+void AsyncColdStorage::setIdleTimeout(qint64 idleTimeout)
+{
+    {
+        QMutexLocker locker(&m_lock);
+        m_idleTimeout = idleTimeout;
+    }
+
+    // reschedule the background thread
+    QMutexLocker locker(&m_threadLock);
+    m_threadWakeUp.wakeAll();
+}
+
+void AsyncColdStorage::setSpillFile(std::shared_ptr<AsyncSpillFile> file, qint64 spillTimeout)
+{
+    {
+        QMutexLocker locker(&m_lock);
+        m_spillFile = std::move(file);
+        m_spillTimeout = spillTimeout;
+    }
+
+    // reschedule the background thread
+    QMutexLocker locker(&m_threadLock);
+    m_threadWakeUp.wakeAll();
+}
+
+void AsyncColdStorage::setCodec(Codec compress, Codec uncompress)
+{
+    QMutexLocker locker(&m_lock);
+    m_compress = std::move(compress);
+    m_uncompress = std::move(uncompress);
+}
+
+int AsyncColdStorage::compressIdleValues()
+{
+    QMutexLocker locker(&m_lock);
+
+    auto values = m_values.keys();
+
+    int compressed = 0;
+    for (auto value : values)
+    {
+        // one value is compressed at a time
+        while (m_compressing)
+            m_compressed.wait(&m_lock);
+
+        // value was removed meanwhile
+        auto it = m_values.find(value);
+        if (it == m_values.end())
+            continue;
+
+        auto evict = it.value();
+        auto idleTimeout = m_idleTimeout;
+
+        // serialization and compression don't block the storage
+        // remove() waits until the value is compressed
+        m_compressing = value;
+        locker.unlock();
+
+        if (evict(idleTimeout))
+            ++compressed;
+
+        locker.relock();
+        m_compressing = nullptr;
+        m_compressed.wakeAll();
+    }
+
+    return compressed;
+}
+
+int AsyncColdStorage::spillIdleValues()
+{
+    std::vector<std::shared_ptr<Packed>> packedValues;
+    std::shared_ptr<AsyncSpillFile> file;
+    qint64 spillTimeout = 0;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        if (!m_spillFile)
+            return 0;
+
+        file = m_spillFile;
+        spillTimeout = m_spillTimeout;
+
+        for (auto it = m_packed.begin(); it != m_packed.end();)
+        {
+            auto packed = it.value().lock();
+
+            // value is restored already
+            if (!packed)
+            {
+                it = m_packed.erase(it);
+                continue;
+            }
+
+            packedValues.push_back(std::move(packed));
+            ++it;
+        }
+    }
+
+    // disk writes don't block the storage
+    int spilled = 0;
+    for (auto& packed : packedValues)
+    {
+        if (packed->spill(file, spillTimeout))
+            ++spilled;
+    }
+
+    return spilled;
+}
+
+qint64 AsyncColdStorage::checkInterval() const
+{
+    QMutexLocker locker(&m_lock);
+
+    if (m_spillFile)
+        return qMin(m_idleTimeout, m_spillTimeout) / 2;
+
+    return m_idleTimeout / 2;
+}
+
+AsyncColdStorage::Packed::Packed(QByteArray data)
+    : m_data(std::move(data)),
+      m_packedAt(QDeadlineTimer::current().deadline())
+{
+}
+
+AsyncColdStorage::Packed::~Packed()
+{
+    if (m_file)
+        m_file->remove(m_id);
+}
+
+QByteArray AsyncColdStorage::Packed::data()
+{
+    std::shared_ptr<AsyncSpillFile> file;
+    quint64 id = 0;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        if (!m_file)
+            return m_data;
+
+        file = m_file;
+        id = m_id;
+    }
+
+    return file->read(id);
+}
+
+bool AsyncColdStorage::Packed::spill(const std::shared_ptr<AsyncSpillFile>& file, qint64 spillTimeout)
+{
+    QByteArray data;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        if (m_file || m_isSpilling || QDeadlineTimer::current().deadline() - m_packedAt < spillTimeout)
+            return false;
+
+        m_isSpilling = true;
+        data = m_data;
+    }
+
+    auto id = file->write(data);
+
+    QMutexLocker locker(&m_lock);
+    m_isSpilling = false;
+
+    if (id == 0)
+        return false;
+
+    m_file = file;
+    m_id = id;
+    m_data = QByteArray();
+    return true;
+}
+
+// should be called under m_lock
+void AsyncColdStorage::startThread()
+{
+    if (m_thread)
+        return;
+
+    m_thread = std::make_unique<AsyncColdStorageThread>(this);
+    m_thread->start(QThread::LowestPriority);
+}
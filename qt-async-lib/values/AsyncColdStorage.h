@@ -0,0 +1,212 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_COLD_STORAGE_H
+#define ASYNC_COLD_STORAGE_H
+
+#include "../Config.h"
+#include "AsyncValueTemplate.h"
+#include "AsyncSpillFile.h"
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+
+class AsyncColdStorageThread;
+
+// compresses content of async values that was not accessed for a while
+// compressed content can be spilled to disk later if spill file is set
+// compression runs in the background thread, content is decompressed on the next access
+// value that cannot be restored (e.g. spill file is lost) gets error state
+// value types should support QDataStream serialization
+// error types should be constructible from QString
+// NOTE: values should be removed before destruction
+class AsyncColdStorage
+{
+    Q_DISABLE_COPY(AsyncColdStorage)
+
+    friend class AsyncColdStorageThread;
+
+public:
+    using Codec = std::function<QByteArray(const QByteArray&)>;
+
+    explicit AsyncColdStorage(qint64 idleTimeout = ASYNC_COLD_STORAGE_IDLE_TIMEOUT);
+    ~AsyncColdStorage();
+
+    qint64 idleTimeout() const;
+    void setIdleTimeout(qint64 idleTimeout);
+
+    // replaces qCompress/qUncompress (e.g. with LZ4 or zstd)
+    void setCodec(Codec compress, Codec uncompress);
+
+    // compressed content is moved to the spill file after spillTimeout
+    // nullptr file disables spilling
+    void setSpillFile(std::shared_ptr<AsyncSpillFile> file, qint64 spillTimeout = ASYNC_COLD_STORAGE_SPILL_TIMEOUT);
+
+    template <typename AsyncValueType>
+    void add(AsyncValueType& value)
+    {
+        using ValueType = typename AsyncValueType::ValueType;
+        using ErrorType = typename AsyncValueType::ErrorType;
+
+        value.setEvictable(true);
+
+        QMutexLocker locker(&m_lock);
+        m_values.insert(&value, [this, &value](qint64 idleTimeout) {
+            return value.evictValue(idleTimeout, [this, &value](const ValueType& content) {
+                return compress(&value, content);
+            }, []() {
+                return std::make_unique<ErrorType>(QString("Evicted value cannot be restored"));
+            });
+        });
+
+        startThread();
+    }
+
+    // brings value back to memory and stops tracking it
+    // waits if the value is being compressed
+    template <typename AsyncValueType>
+    void remove(AsyncValueType& value)
+    {
+        {
+            QMutexLocker locker(&m_lock);
+            m_values.remove(&value);
+
+            while (m_compressing == &value)
+                m_compressed.wait(&m_lock);
+
+            m_packed.remove(&value);
+        }
+
+        value.setEvictable(false);
+    }
+
+    // compresses values that were idle for idleTimeout
+    // returns number of compressed values
+    int compressIdleValues();
+    // moves values compressed for spillTimeout to the spill file
+    // returns number of spilled values
+    int spillIdleValues();
+
+    // serializes value with QDataStream
+    template <typename ValueType>
+    static QByteArray serialize(const ValueType& value)
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << value;
+        return data;
+    }
+
+    template <typename ValueType>
+    static std::shared_ptr<ValueType> deserialize(const QByteArray& data)
+    {
+        auto value = std::make_shared<ValueType>();
+        QDataStream stream(data);
+        stream >> *value;
+        return value;
+    }
+
+private:
+    // compressed content of the evicted value
+    // it's kept in memory or in the spill file
+    class Packed
+    {
+        Q_DISABLE_COPY(Packed)
+
+    public:
+        explicit Packed(QByteArray data);
+        ~Packed();
+
+        // returns null QByteArray if spilled content cannot be read
+        QByteArray data();
+        // writes content to the file outside of the lock
+        bool spill(const std::shared_ptr<AsyncSpillFile>& file, qint64 spillTimeout);
+
+    private:
+        QMutex m_lock;
+        QByteArray m_data;
+        qint64 m_packedAt;
+        std::shared_ptr<AsyncSpillFile> m_file;
+        quint64 m_id = 0;
+        bool m_isSpilling = false;
+    };
+
+    // called outside of m_lock while value is being compressed
+    template <typename ValueType>
+    std::function<std::shared_ptr<ValueType>()> compress(AsyncValueBase* value, const ValueType& content)
+    {
+        Codec compress, uncompress;
+        {
+            QMutexLocker locker(&m_lock);
+            compress = m_compress;
+            uncompress = m_uncompress;
+        }
+
+        auto data = serialize(content);
+        auto compressed = compress(data);
+
+        // not worth to keep compressed
+        if (compressed.size() >= data.size())
+            return nullptr;
+
+        compressed.squeeze();
+        auto packed = std::make_shared<Packed>(std::move(compressed));
+
+        {
+            // packed content is released when value is restored
+            QMutexLocker locker(&m_lock);
+            m_packed.insert(value, packed);
+        }
+
+        return [packed, uncompress = std::move(uncompress)]() -> std::shared_ptr<ValueType> {
+            auto data = packed->data();
+            if (data.isNull())
+                return nullptr;
+
+            data = uncompress(data);
+            if (data.isEmpty())
+                return nullptr;
+
+            return deserialize<ValueType>(data);
+        };
+    }
+
+    qint64 checkInterval() const;
+    void startThread();
+
+    mutable QMutex m_lock;
+    QHash<AsyncValueBase*, std::function<bool(qint64)>> m_values;
+    // value compressed outside of m_lock
+    AsyncValueBase* m_compressing = nullptr;
+    QWaitCondition m_compressed;
+    qint64 m_idleTimeout;
+    Codec m_compress;
+    Codec m_uncompress;
+    QHash<AsyncValueBase*, std::weak_ptr<Packed>> m_packed;
+    std::shared_ptr<AsyncSpillFile> m_spillFile;
+    qint64 m_spillTimeout = ASYNC_COLD_STORAGE_SPILL_TIMEOUT;
+
+    QMutex m_threadLock;
+    QWaitCondition m_threadWakeUp;
+    bool m_threadStop = false;
+    std::unique_ptr<AsyncColdStorageThread> m_thread;
+};
+
+#endif // ASYNC_COLD_STORAGE_H
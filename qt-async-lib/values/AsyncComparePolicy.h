@@ -0,0 +1,98 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_COMPARE_POLICY_H
+#define ASYNC_COMPARE_POLICY_H
+
+#include <QHash>
+#include <memory>
+
+// compare policies skip notifications about directly assigned values equal to the current one
+// calculations going through the progress state always notify observers
+
+// values are always treated as different
+struct AsyncComparePolicyNone
+{
+    template <typename T>
+    bool equal(const T&, const T&) const { return false; }
+};
+
+// values are compared using operator==
+struct AsyncComparePolicyEqual
+{
+    template <typename T>
+    bool equal(const T& left, const T& right) const { return left == right; }
+};
+
+struct AsyncQHasher
+{
+    template <typename T>
+    uint operator()(const T& value) const { return qHash(value); }
+};
+
+// values are compared using hash function
+// NOTE: values with equal hashes are treated as equal
+template <typename Hasher_t = AsyncQHasher>
+struct AsyncComparePolicyHash
+{
+    template <typename T>
+    bool equal(const T& left, const T& right) const { return m_hasher(left) == m_hasher(right); }
+
+    template <typename T>
+    uint hash(const T& value) const { return m_hasher(value); }
+
+private:
+    Hasher_t m_hasher;
+};
+
+// keeps what compare policy needs to compare the last value with the new ones
+template <typename T, typename ComparePolicy_t>
+class AsyncCompareSnapshot
+{
+public:
+    bool isEqual(const ComparePolicy_t& compare, const T& value) const { return m_value && compare.equal(*m_value, value); }
+    void assign(const ComparePolicy_t&, const T& value) { m_value = std::make_unique<T>(value); }
+    void reset() { m_value = nullptr; }
+
+private:
+    std::unique_ptr<T> m_value;
+};
+
+// values are always different -> nothing to keep
+template <typename T>
+class AsyncCompareSnapshot<T, AsyncComparePolicyNone>
+{
+public:
+    bool isEqual(const AsyncComparePolicyNone&, const T&) const { return false; }
+    void assign(const AsyncComparePolicyNone&, const T&) {}
+    void reset() {}
+};
+
+// only hash of the last value is kept
+template <typename T, typename Hasher_t>
+class AsyncCompareSnapshot<T, AsyncComparePolicyHash<Hasher_t>>
+{
+public:
+    bool isEqual(const AsyncComparePolicyHash<Hasher_t>& compare, const T& value) const { return m_hasHash && compare.hash(value) == m_hash; }
+    void assign(const AsyncComparePolicyHash<Hasher_t>& compare, const T& value) { m_hash = compare.hash(value); m_hasHash = true; }
+    void reset() { m_hasHash = false; }
+
+private:
+    uint m_hash = 0;
+    bool m_hasHash = false;
+};
+
+#endif // ASYNC_COMPARE_POLICY_H
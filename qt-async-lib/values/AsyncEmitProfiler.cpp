@@ -0,0 +1,93 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncEmitProfiler.h"
+#include "AsyncValueBase.h"
+#include <QDebug>
+
+static const char* stateName(ASYNC_VALUE_STATE state)
+{
+    switch (state)
+    {
+    case ASYNC_VALUE_STATE::VALUE:
+        return "value";
+    case ASYNC_VALUE_STATE::ERROR:
+        return "error";
+    case ASYNC_VALUE_STATE::PROGRESS:
+        return "progress";
+    }
+
+    return "";
+}
+
+void AsyncEmitProfiler::record(AsyncValueBase* value, ASYNC_VALUE_STATE state, qint64 duration)
+{
+    m_emits.fetchAndAddRelaxed(1);
+    if (!m_slowEmits.isSlow(duration))
+        return;
+
+    SlowEmit slowEmit;
+    slowEmit.value = asyncObjectName(value);
+    slowEmit.state = QString::fromLatin1(stateName(state));
+    slowEmit.thread = QThread::currentThread()->objectName();
+    slowEmit.receivers = value->receivers(SIGNAL(stateChanged(ASYNC_VALUE_STATE)));
+    slowEmit.duration = duration;
+
+    qWarning() << "Slow stateChanged handlers:" << slowEmit.value << slowEmit.state
+               << "receivers" << slowEmit.receivers << "took" << duration << "usec";
+
+    m_slowEmits.insert(std::move(slowEmit));
+}
+
+void AsyncEmitProfiler::reset()
+{
+    m_emits.storeRelease(0);
+    m_slowEmits.reset();
+}
+
+QJsonObject AsyncEmitProfiler::toJson() const
+{
+    QJsonObject result;
+
+    result.insert("emits", static_cast<double>(m_emits.loadAcquire()));
+    result.insert("slowEmits", m_slowEmits.toJson([](const SlowEmit& slowEmit) {
+        QJsonObject item;
+        item.insert("value", slowEmit.value);
+        item.insert("state", slowEmit.state);
+        item.insert("thread", slowEmit.thread);
+        item.insert("receivers", slowEmit.receivers);
+        item.insert("duration", static_cast<double>(slowEmit.duration));
+        return item;
+    }));
+
+    return result;
+}
+
+AsyncEmitProfiler::Emit::Emit(AsyncValueBase* value, ASYNC_VALUE_STATE state, AsyncEmitProfiler* profiler)
+    : m_profiler(profiler),
+      m_value(value),
+      m_state(state),
+      m_isEnabled(profiler->isEnabled())
+{
+    if (m_isEnabled)
+        m_timer.start();
+}
+
+AsyncEmitProfiler::Emit::~Emit()
+{
+    if (m_isEnabled)
+        m_profiler->record(m_value, m_state, m_timer.nsecsElapsed() / 1000);
+}
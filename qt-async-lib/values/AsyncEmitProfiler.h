@@ -0,0 +1,89 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_EMIT_PROFILER_H
+#define ASYNC_EMIT_PROFILER_H
+
+#include "../Config.h"
+#include "AsyncProfiler.h"
+#include <QString>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <vector>
+
+class AsyncValueBase;
+enum class ASYNC_VALUE_STATE;
+
+// measures duration of stateChanged emits (i.e. of the directly connected handlers)
+// emits longer than the threshold are logged and the slowest ones are kept
+// NOTE: emits are measured only if enabled
+class AsyncEmitProfiler : public AsyncProfiler<AsyncEmitProfiler>
+{
+    Q_DISABLE_COPY(AsyncEmitProfiler)
+
+public:
+    // durations are in microseconds
+    struct SlowEmit
+    {
+        // value object name or type name
+        QString value;
+        QString state;
+        QString thread;
+        int receivers = 0;
+        qint64 duration = 0;
+    };
+
+    AsyncEmitProfiler() = default;
+
+    qint64 threshold() const { return m_slowEmits.threshold(); }
+    void setThreshold(qint64 threshold) { m_slowEmits.setThreshold(threshold); }
+    void setMaxSlowEmits(int maxSlowEmits) { m_slowEmits.setMaxRecords(maxSlowEmits); }
+
+    void record(AsyncValueBase* value, ASYNC_VALUE_STATE state, qint64 duration);
+
+    quint64 emits() const { return m_emits.loadAcquire(); }
+    // returns slow emits from the slowest one
+    std::vector<SlowEmit> slowEmits() const { return m_slowEmits.records(); }
+    void reset();
+
+    // returns {"emits": 10, "slowEmits": [{"value": "name", "state": "value", "thread": "", "receivers": 1, "duration": 20000}, ...]}
+    QJsonObject toJson() const;
+
+    // measures stateChanged emit in the current thread
+    class Emit
+    {
+        Q_DISABLE_COPY(Emit)
+
+    public:
+        Emit(AsyncValueBase* value, ASYNC_VALUE_STATE state, AsyncEmitProfiler* profiler = globalInstance());
+        ~Emit();
+
+    private:
+        AsyncEmitProfiler* m_profiler;
+        AsyncValueBase* m_value;
+        ASYNC_VALUE_STATE m_state;
+        bool m_isEnabled;
+        QElapsedTimer m_timer;
+    };
+
+private:
+    // fast emits are counted without locking
+    QAtomicInteger<quint64> m_emits { 0 };
+    AsyncSlowestRecords<SlowEmit> m_slowEmits { ASYNC_SLOW_EMIT_THRESHOLD_USEC, ASYNC_SLOW_EMIT_MAX_RECORDS };
+};
+
+#endif // ASYNC_EMIT_PROFILER_H
@@ -0,0 +1,145 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncNumaPools.h"
+#include "AsyncValueBase.h"
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+#include <limits>
+
+// parses cpu list like "0-3,8-11"
+static std::vector<int> parseCpuList(const QString& cpuList)
+{
+    std::vector<int> cpus;
+
+    for (const auto& range : cpuList.split(','))
+    {
+        if (range.isEmpty())
+            continue;
+
+        auto bounds = range.split('-');
+
+        bool isFirstOk = false;
+        bool isLastOk = false;
+        auto first = bounds.front().toInt(&isFirstOk);
+        auto last = bounds.size() > 1 ? bounds.back().toInt(&isLastOk) : first;
+        if (!isFirstOk || (bounds.size() > 1 && !isLastOk))
+            return {};
+
+        for (auto cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+// returns cpus of NUMA nodes that have cpus in the order of node numbers
+// memory-only nodes (HBM, CXL) and gaps in numbering are skipped
+static std::vector<std::vector<int>> numaNodes()
+{
+    std::vector<std::vector<int>> nodes;
+
+#ifdef Q_OS_LINUX
+    QDir nodesDir("/sys/devices/system/node");
+
+    std::vector<int> nodeNumbers;
+    for (const auto& entry : nodesDir.entryList(QStringList() << "node*", QDir::Dirs))
+    {
+        bool isOk = false;
+        auto node = entry.mid(4).toInt(&isOk);
+        if (isOk)
+            nodeNumbers.push_back(node);
+    }
+    std::sort(nodeNumbers.begin(), nodeNumbers.end());
+
+    for (auto node : nodeNumbers)
+    {
+        QFile cpuListFile(nodesDir.filePath(QString("node%1/cpulist").arg(node)));
+        if (!cpuListFile.open(QIODevice::ReadOnly))
+            continue;
+
+        auto cpus = parseCpuList(QString::fromLatin1(cpuListFile.readAll()).trimmed());
+        if (cpus.empty())
+            continue;
+
+        nodes.push_back(std::move(cpus));
+    }
+#endif
+
+    return nodes;
+}
+
+AsyncNumaPools::AsyncNumaPools()
+{
+    auto nodes = numaNodes();
+
+    // no need to pin threads on single node systems
+    if (nodes.size() < 2)
+    {
+        m_nodes.emplace_back();
+        return;
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        Node node;
+        node.threadPool = std::make_unique<QThreadPool>();
+        node.threadPool->setMaxThreadCount(static_cast<int>(nodes[i].size()));
+        node.pool = std::make_unique<AsyncThreadPool>(node.threadPool.get());
+        node.pool->setThreadAffinity(static_cast<int>(i), std::move(nodes[i]));
+
+        m_nodes.push_back(std::move(node));
+    }
+}
+
+AsyncNumaPools* AsyncNumaPools::globalInstance()
+{
+    static AsyncNumaPools instance;
+    return &instance;
+}
+
+AsyncThreadPool* AsyncNumaPools::pool(int node) const
+{
+    Q_ASSERT(node >= 0 && node < nodeCount());
+
+    auto pool = m_nodes[node].pool.get();
+    return pool ? pool : AsyncThreadPool::globalInstance();
+}
+
+AsyncThreadPool* AsyncNumaPools::poolFor(const AsyncValueBase& value) const
+{
+    auto node = value.m_numaNode.loadAcquire();
+    if (node >= 0 && node < nodeCount())
+        return pool(node);
+
+    int bestNode = 0;
+    int bestLoad = std::numeric_limits<int>::max();
+
+    for (auto i = 0; i < nodeCount(); ++i)
+    {
+        auto telemetry = pool(i)->telemetry();
+        auto load = telemetry.queueSize + telemetry.activeThreads;
+        if (load < bestLoad)
+        {
+            bestNode = i;
+            bestLoad = load;
+        }
+    }
+
+    return pool(bestNode);
+}
@@ -0,0 +1,53 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_NUMA_POOLS_H
+#define ASYNC_NUMA_POOLS_H
+
+#include "AsyncThreadPool.h"
+#include <vector>
+
+// keeps thread pool per NUMA node with threads pinned to the node cpus
+// tasks of an async value are run on the node where the value was calculated last time,
+// so its content is allocated and read by threads of one node (first-touch policy)
+// pools are indexed by nodes with cpus in the order of node numbers
+// NOTE: NUMA nodes are detected on Linux only, otherwise global pool is used
+class AsyncNumaPools
+{
+    Q_DISABLE_COPY(AsyncNumaPools)
+
+public:
+    AsyncNumaPools();
+
+    static AsyncNumaPools* globalInstance();
+
+    int nodeCount() const { return static_cast<int>(m_nodes.size()); }
+    AsyncThreadPool* pool(int node) const;
+    // returns pool of the node where value was calculated
+    // or the least loaded pool if value hasn't been calculated in the pools yet
+    AsyncThreadPool* poolFor(const AsyncValueBase& value) const;
+
+private:
+    struct Node
+    {
+        std::unique_ptr<QThreadPool> threadPool;
+        // destroyed before its thread pool
+        std::unique_ptr<AsyncThreadPool> pool;
+    };
+    std::vector<Node> m_nodes;
+};
+
+#endif // ASYNC_NUMA_POOLS_H
@@ -0,0 +1,316 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_PREFETCH_CACHE_H
+#define ASYNC_PREFETCH_CACHE_H
+
+#include "../Config.h"
+#include "AsyncProgress.h"
+#include "AsyncValueRunThreadPool.h"
+#include <QHash>
+#include <QMutex>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// keeps async values calculated for keys
+// predicted keys can be prefetched with low priority
+// when prefetched key is requested its calculation gets normal priority
+// prefetches are skipped if the pool is busy and can be cancelled on memory pressure
+template <typename Key_t, typename AsyncValueType_t>
+class AsyncPrefetchCache
+{
+    Q_DISABLE_COPY(AsyncPrefetchCache)
+
+public:
+    using Key = Key_t;
+    using AsyncValueType = AsyncValueType_t;
+    using ProgressType = typename AsyncValueType::ProgressType;
+    using CalculateFn = std::function<void(const Key&, ProgressType&, AsyncValueType&)>;
+
+    AsyncPrefetchCache(int maxSize, CalculateFn calculate, AsyncThreadPool* pool = AsyncThreadPool::globalInstance(), AsyncTaskOptions options = AsyncTaskOptions())
+        : m_maxSize(maxSize),
+          m_calculate(std::move(calculate)),
+          m_pool(pool),
+          m_options(std::move(options))
+    {
+        Q_ASSERT(m_maxSize > 0);
+        Q_ASSERT(m_calculate);
+    }
+
+    ~AsyncPrefetchCache()
+    {
+        cancelPrefetches();
+
+        std::vector<std::shared_ptr<AsyncValueType>> values;
+
+        {
+            QMutexLocker locker(&m_lock);
+
+            for (auto& entry : m_entries)
+                values.push_back(entry.value);
+            values.insert(values.end(), m_cancelled.begin(), m_cancelled.end());
+        }
+
+        // calculations reference cached values
+        for (auto& value : values)
+            value->wait();
+    }
+
+    // returns value for the key
+    // starts calculation or raises priority of the prefetch
+    // cancels outstanding prefetches if the pool is busy
+    std::shared_ptr<AsyncValueType> get(const Key& key)
+    {
+        std::shared_ptr<AsyncValueType> value;
+
+        {
+            QMutexLocker locker(&m_lock);
+
+            auto it = m_entries.find(key);
+            if (it != m_entries.end())
+            {
+                auto& entry = it.value();
+                entry.lastUse = ++m_useCounter;
+
+                if (entry.isPrefetch)
+                {
+                    // prediction was right
+                    entry.isPrefetch = false;
+                    m_pool->setTaskPriority(entry.value.get(), m_options.priority);
+                }
+
+                return entry.value;
+            }
+
+            // requested value is cached even if there is no room
+            makeRoom();
+            value = addEntry(key, false);
+        }
+
+        if (isPoolBusy())
+            cancelPrefetches(true);
+
+        launch(key, value);
+        return value;
+    }
+
+    // starts low priority calculation for the predicted key
+    // returns false if cache is full or pool is busy
+    // outstanding prefetches are cancelled if the pool is busy
+    bool prefetch(const Key& key)
+    {
+        if (isPoolBusy())
+        {
+            cancelPrefetches(true);
+            return contains(key);
+        }
+
+        std::shared_ptr<AsyncValueType> value;
+
+        {
+            QMutexLocker locker(&m_lock);
+
+            if (m_entries.contains(key))
+                return true;
+
+            if (!makeRoom())
+                return false;
+
+            value = addEntry(key, true);
+        }
+
+        launch(key, value);
+        return true;
+    }
+
+    // stops prefetches that haven't been requested yet
+    // onlyInProgress keeps calculated prefetches
+    void cancelPrefetches(bool onlyInProgress = false)
+    {
+        QMutexLocker locker(&m_lock);
+
+        for (auto it = m_entries.begin(); it != m_entries.end(); )
+        {
+            if (!it.value().isPrefetch || (onlyInProgress && it.value().isLaunched && !isInProgress(*it.value().value)))
+            {
+                ++it;
+                continue;
+            }
+
+            auto value = it.value().value;
+            value->accessProgress([](ProgressType& progress) {
+                progress.requestStop();
+            });
+
+            // keep value until its calculation completes
+            m_cancelled.push_back(std::move(value));
+            it = m_entries.erase(it);
+        }
+    }
+
+    bool contains(const Key& key) const
+    {
+        QMutexLocker locker(&m_lock);
+        return m_entries.contains(key);
+    }
+
+    int size() const
+    {
+        QMutexLocker locker(&m_lock);
+        return m_entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<AsyncValueType> value;
+        bool isPrefetch = false;
+        // calculation is started outside of m_lock
+        bool isLaunched = false;
+        quint64 lastUse = 0;
+    };
+
+    static bool isInProgress(AsyncValueType& value)
+    {
+        return value.accessProgress([](ProgressType&) {});
+    }
+
+    bool isPoolBusy() const
+    {
+        auto telemetry = m_pool->telemetry();
+        return telemetry.queueSize > 0 || telemetry.idleThreads == 0;
+    }
+
+    // should be called under m_lock
+    std::shared_ptr<AsyncValueType> addEntry(const Key& key, bool isPrefetch)
+    {
+        auto value = std::make_shared<AsyncValueType>(AsyncInitByError(), QString("Not calculated"));
+
+        Entry entry;
+        entry.value = value;
+        entry.isPrefetch = isPrefetch;
+        entry.lastUse = ++m_useCounter;
+        m_entries.insert(key, entry);
+
+        return value;
+    }
+
+    // starts calculation of the added entry outside of m_lock
+    // the entry could be requested or cancelled meanwhile
+    void launch(const Key& key, const std::shared_ptr<AsyncValueType>& value)
+    {
+        auto options = m_options;
+
+        {
+            QMutexLocker locker(&m_lock);
+
+            auto entry = findEntry(key, value);
+            if (!entry)
+                return;
+
+            if (entry->isPrefetch)
+                options.priority = ASYNC_PREFETCH_PRIORITY;
+        }
+
+        asyncValueRunThreadPool(m_pool, options, *value, [calculate = m_calculate, key](ProgressType& progress, AsyncValueType& value) {
+            // prefetch could be cancelled while queued
+            if (progress.isStopRequested())
+            {
+                value.emplaceError(QString("Prefetch cancelled"));
+                return;
+            }
+
+            calculate(key, progress, value);
+        }, QString("Prefetching..."), ASYNC_CAN_REQUEST_STOP::YES);
+
+        QMutexLocker locker(&m_lock);
+
+        auto entry = findEntry(key, value);
+        if (!entry)
+        {
+            // cancelled while launching
+            value->accessProgress([](ProgressType& progress) {
+                progress.requestStop();
+            });
+
+            if (std::find(m_cancelled.begin(), m_cancelled.end(), value) == m_cancelled.end())
+                m_cancelled.push_back(value);
+
+            return;
+        }
+
+        entry->isLaunched = true;
+
+        // requested while launching
+        if (!entry->isPrefetch && options.priority != m_options.priority)
+            m_pool->setTaskPriority(value.get(), m_options.priority);
+    }
+
+    // should be called under m_lock
+    Entry* findEntry(const Key& key, const std::shared_ptr<AsyncValueType>& value)
+    {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end() || it.value().value != value)
+            return nullptr;
+
+        return &it.value();
+    }
+
+    // evicts the least recently used calculated value if cache is full
+    // returns false if there is no room
+    // should be called under m_lock
+    bool makeRoom()
+    {
+        // forget cancelled values with completed calculations
+        m_cancelled.erase(std::remove_if(m_cancelled.begin(), m_cancelled.end(), [](const std::shared_ptr<AsyncValueType>& value) {
+            return !isInProgress(*value);
+        }), m_cancelled.end());
+
+        if (m_entries.size() < m_maxSize)
+            return true;
+
+        auto victimIt = m_entries.end();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (!it.value().isLaunched || isInProgress(*it.value().value))
+                continue;
+
+            if (victimIt == m_entries.end() || it.value().lastUse < victimIt.value().lastUse)
+                victimIt = it;
+        }
+
+        if (victimIt == m_entries.end())
+            return false;
+
+        m_entries.erase(victimIt);
+        return true;
+    }
+
+    const int m_maxSize;
+    const CalculateFn m_calculate;
+    AsyncThreadPool* m_pool;
+    const AsyncTaskOptions m_options;
+
+    mutable QMutex m_lock;
+    QHash<Key, Entry> m_entries;
+    // cancelled values waiting for calculation completion
+    std::vector<std::shared_ptr<AsyncValueType>> m_cancelled;
+    quint64 m_useCounter = 0;
+};
+
+#endif // ASYNC_PREFETCH_CACHE_H
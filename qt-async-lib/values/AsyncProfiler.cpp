@@ -0,0 +1,45 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncProfiler.h"
+#include <QObject>
+#include <cstdlib>
+#include <memory>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+QString asyncTypeName(const std::type_info& type)
+{
+#if defined(__GNUG__)
+    int status = 0;
+    std::unique_ptr<char, void(*)(void*)> name(abi::__cxa_demangle(type.name(), nullptr, nullptr, &status), std::free);
+    if (status == 0 && name)
+        return QString::fromLatin1(name.get());
+#endif
+
+    return QString::fromLatin1(type.name());
+}
+
+QString asyncObjectName(const QObject* object)
+{
+    auto name = object->objectName();
+    if (name.isEmpty())
+        name = asyncTypeName(typeid(*object));
+
+    return name;
+}
@@ -0,0 +1,134 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_PROFILER_H
+#define ASYNC_PROFILER_H
+
+#include <QMutex>
+#include <QString>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QAtomicInt>
+#include <algorithm>
+#include <typeinfo>
+#include <vector>
+
+class QObject;
+
+// returns human readable (demangled) name of the type
+QString asyncTypeName(const std::type_info& type);
+// returns object name or type name of the object
+QString asyncObjectName(const QObject* object);
+
+// global instance and enabled switch of the profiler
+// NOTE: profilers are disabled by default
+template <typename Profiler>
+class AsyncProfiler
+{
+public:
+    static Profiler* globalInstance()
+    {
+        static Profiler instance;
+        return &instance;
+    }
+
+    bool isEnabled() const { return m_isEnabled.loadAcquire() != 0; }
+    void setEnabled(bool enabled) { m_isEnabled.storeRelease(enabled ? 1 : 0); }
+
+private:
+    QAtomicInt m_isEnabled { 0 };
+};
+
+// keeps the slowest records sorted from the slowest one
+// records shorter than the threshold are skipped
+// Record should have duration member
+template <typename Record>
+class AsyncSlowestRecords
+{
+    Q_DISABLE_COPY(AsyncSlowestRecords)
+
+public:
+    AsyncSlowestRecords(qint64 threshold, int maxRecords)
+        : m_threshold(threshold),
+          m_maxRecords(maxRecords)
+    {
+    }
+
+    qint64 threshold() const { return m_threshold.loadAcquire(); }
+    void setThreshold(qint64 threshold) { m_threshold.storeRelease(threshold); }
+
+    bool isSlow(qint64 duration) const { return duration >= threshold(); }
+
+    void setMaxRecords(int maxRecords)
+    {
+        QMutexLocker locker(&m_lock);
+
+        m_maxRecords = maxRecords;
+        if (static_cast<int>(m_records.size()) > m_maxRecords)
+            m_records.resize(static_cast<size_t>(qMax(m_maxRecords, 0)));
+    }
+
+    void insert(Record record)
+    {
+        QMutexLocker locker(&m_lock);
+
+        auto it = std::upper_bound(m_records.begin(), m_records.end(), record.duration, [](qint64 duration, const Record& record) {
+            return duration > record.duration;
+        });
+
+        if (std::distance(m_records.begin(), it) >= m_maxRecords)
+            return;
+
+        m_records.insert(it, std::move(record));
+        if (static_cast<int>(m_records.size()) > m_maxRecords)
+            m_records.pop_back();
+    }
+
+    std::vector<Record> records() const
+    {
+        QMutexLocker locker(&m_lock);
+        return m_records;
+    }
+
+    void reset()
+    {
+        QMutexLocker locker(&m_lock);
+        m_records.clear();
+    }
+
+    // toJson converts record to QJsonObject
+    template <typename ToJson>
+    QJsonArray toJson(ToJson&& toJson) const
+    {
+        QJsonArray result;
+
+        QMutexLocker locker(&m_lock);
+
+        for (const auto& record : m_records)
+            result.append(toJson(record));
+
+        return result;
+    }
+
+private:
+    QAtomicInteger<qint64> m_threshold;
+
+    mutable QMutex m_lock;
+    int m_maxRecords;
+    std::vector<Record> m_records;
+};
+
+#endif // ASYNC_PROFILER_H
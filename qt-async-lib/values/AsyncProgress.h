@@ -19,6 +19,8 @@
 
 #include <QObject>
 #include <QReadWriteLock>
+#include <QByteArray>
+#include <memory>
 
 enum class ASYNC_CAN_REQUEST_STOP
 {
@@ -115,8 +117,68 @@ public:
         return true;
     }
 
+    // saves intermediate state of the calculation made for the input fingerprint
+    // rerun with the same fingerprint can resume from the checkpoint
+    template <typename State>
+    void saveCheckpoint(QByteArray fingerprint, State state)
+    {
+        auto newCheckpoint = std::make_unique<Checkpoint<State>>();
+        newCheckpoint->fingerprint = std::move(fingerprint);
+        newCheckpoint->state = std::move(state);
+
+        // old checkpoint is destroyed outside the lock
+        std::unique_ptr<CheckpointBase> checkpoint = std::move(newCheckpoint);
+
+        QWriteLocker locker(&m_lock);
+        std::swap(m_checkpoint, checkpoint);
+    }
+
+    // takes saved state if the checkpoint has the same fingerprint and state type
+    // returns false if there is no suitable checkpoint
+    template <typename State>
+    bool loadCheckpoint(const QByteArray& fingerprint, State& state)
+    {
+        std::unique_ptr<CheckpointBase> checkpoint;
+
+        {
+            QWriteLocker locker(&m_lock);
+
+            auto typedCheckpoint = dynamic_cast<Checkpoint<State>*>(m_checkpoint.get());
+            if (!typedCheckpoint || typedCheckpoint->fingerprint != fingerprint)
+                return false;
+
+            state = std::move(typedCheckpoint->state);
+            checkpoint = std::move(m_checkpoint);
+        }
+
+        return true;
+    }
+
+    void clearCheckpoint()
+    {
+        std::unique_ptr<CheckpointBase> checkpoint;
+
+        QWriteLocker locker(&m_lock);
+        checkpoint = std::move(m_checkpoint);
+    }
+
 protected:
     bool m_isRerunRequested = false;
+
+    struct CheckpointBase
+    {
+        virtual ~CheckpointBase() = default;
+
+        QByteArray fingerprint;
+    };
+
+    template <typename State>
+    struct Checkpoint : CheckpointBase
+    {
+        State state;
+    };
+
+    std::unique_ptr<CheckpointBase> m_checkpoint;
 };
 
 #endif // ASYNC_PROGRESS_H
@@ -0,0 +1,236 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_PROJECTION_H
+#define ASYNC_PROJECTION_H
+
+#include <memory>
+#include <type_traits>
+#include "AsyncValueTemplate.h"
+#include "AsyncComparePolicy.h"
+
+template <typename ValueType, typename MemberType, typename = std::enable_if_t<!std::is_function<MemberType>::value>>
+MemberType& asyncProject(MemberType ValueType::* member, ValueType& value)
+{
+    return value.*member;
+}
+
+template <typename Projection, typename ValueType>
+auto asyncProject(Projection& projection, ValueType& value) -> decltype(projection(value))
+{
+    return projection(value);
+}
+
+// read-only async value that represents a part of the parent async value
+// projected value is taken from the parent's value the projection was last notified about
+// stateChanged signal is emitted only when projected value is changed
+// while parent is recalculated projection keeps VALUE state and its value without notifications
+// projected values are compared only while the projection has observers
+// NOTE: projection shares parent's value (it's not evicted or modified in place while shared)
+// NOTE: projection should not outlive parent async value
+template <typename AsyncValueType, typename Projection_t, typename ComparePolicy_t = AsyncComparePolicyEqual>
+class AsyncProjection : public AsyncValueBase
+{
+public:
+    using ParentValueType = typename AsyncValueType::ValueType;
+    using ValueType = std::decay_t<decltype(asyncProject(std::declval<Projection_t&>(), std::declval<ParentValueType&>()))>;
+    using ErrorType = typename AsyncValueType::ErrorType;
+    using ProgressType = typename AsyncValueType::ProgressType;
+
+    AsyncProjection(AsyncValueType& parent, Projection_t projection)
+        : AsyncValueBase(ASYNC_VALUE_STATE::PROGRESS, nullptr),
+          m_parent(parent),
+          m_projection(std::move(projection))
+    {
+        WriteLocker writeLocker(this, "projection");
+
+        // compare projected values in the parent's emitting thread
+        QObject::connect(&m_parent, &AsyncValueBase::stateChanged, this, [this](ASYNC_VALUE_STATE state) {
+            onParentStateChanged(state);
+        }, Qt::DirectConnection);
+
+        m_parentValue = m_parent.sharedValue();
+        if (m_parentValue)
+        {
+            m_lastValue.assign(m_compare, asyncProject(m_projection, *m_parentValue));
+            m_state = ASYNC_VALUE_STATE::VALUE;
+            return;
+        }
+
+        // value assigned meanwhile is reported by the parent's notification
+        m_parent.access(AsyncNoOp(), [this](ErrorType&) {
+            m_state = ASYNC_VALUE_STATE::ERROR;
+        }, [this](ProgressType&) {
+            m_state = ASYNC_VALUE_STATE::PROGRESS;
+        });
+    }
+
+    template <typename ValuePred, typename ErrorPred, typename ProgressPred>
+    void access(ValuePred valuePred, ErrorPred errorPred, ProgressPred progressPred)
+    {
+        if (!accessLastValue(valuePred))
+            m_parent.access(projectPred(valuePred), errorPred, progressPred);
+    }
+
+    template <typename ValuePred, typename ErrorPred>
+    bool access(ValuePred valuePred, ErrorPred errorPred)
+    {
+        return accessLastValue(valuePred) || m_parent.access(projectPred(valuePred), errorPred);
+    }
+
+    template <typename Pred>
+    bool access(Pred valuePred)
+    {
+        return accessLastValue(valuePred) || m_parent.access(projectPred(valuePred));
+    }
+
+    template <typename Pred>
+    bool accessValue(Pred valuePred)
+    {
+        return access(valuePred);
+    }
+
+    template <typename Pred>
+    bool accessError(Pred errorPred)
+    {
+        return m_parent.accessError(errorPred);
+    }
+
+    template <typename Pred>
+    bool accessProgress(Pred progressPred)
+    {
+        return m_parent.accessProgress(progressPred);
+    }
+
+    template <typename ValuePred, typename ErrorPred>
+    void wait(ValuePred valuePred, ErrorPred errorPred)
+    {
+        if (!accessLastValue(valuePred))
+            m_parent.wait(projectPred(valuePred), errorPred);
+    }
+
+    void wait()
+    {
+        wait(AsyncNoOp(), AsyncNoOp());
+    }
+
+private:
+    template <typename Pred>
+    auto projectPred(Pred& valuePred)
+    {
+        return [this, &valuePred](ParentValueType& value) {
+            auto&& projectedValue = asyncProject(m_projection, value);
+            valuePred(projectedValue);
+        };
+    }
+
+    // calls valuePred with projection of the parent's value if projection has VALUE state
+    template <typename Pred>
+    bool accessLastValue(Pred& valuePred)
+    {
+        std::shared_ptr<ParentValueType> parentValue;
+
+        {
+            ReadLocker locker(this, "access");
+
+            if (m_state != ASYNC_VALUE_STATE::VALUE)
+                return false;
+
+            parentValue = m_parentValue;
+        }
+
+        auto&& projectedValue = asyncProject(m_projection, *parentValue);
+        valuePred(projectedValue);
+        return true;
+    }
+
+    // called in the parent's emitting thread under parent's write lock
+    void onParentStateChanged(ASYNC_VALUE_STATE state)
+    {
+        std::shared_ptr<ParentValueType> parentValue;
+        bool isChanged = true;
+
+        if (state == ASYNC_VALUE_STATE::VALUE)
+        {
+            parentValue = m_parent.sharedValue();
+            if (!parentValue)
+                return;
+
+            // projected value is calculated outside of the projection's locks
+            // and only if somebody observes the projection
+            if (receivers(SIGNAL(stateChanged(ASYNC_VALUE_STATE))) > 0)
+            {
+                auto&& projectedValue = asyncProject(m_projection, *parentValue);
+
+                if (stateSnapshot() == ASYNC_VALUE_STATE::VALUE && m_lastValue.isEqual(m_compare, projectedValue))
+                    isChanged = false;
+                else
+                    m_lastValue.assign(m_compare, projectedValue);
+            }
+            else
+            {
+                m_lastValue.reset();
+            }
+        }
+        else if (state == ASYNC_VALUE_STATE::PROGRESS)
+        {
+            // keep the last value until parent completes
+            // so unchanged projected value doesn't cause notifications
+            if (stateSnapshot() == ASYNC_VALUE_STATE::VALUE)
+                return;
+        }
+        else
+        {
+            m_lastValue.reset();
+        }
+
+        WriteLocker writeLocker(this, "projection");
+
+        {
+            QWriteLocker locker(&m_contentLock);
+            // released outside of the lock
+            std::swap(m_parentValue, parentValue);
+            m_state = state;
+        }
+
+        if (isChanged)
+            emit stateChanged(state);
+    }
+
+    ASYNC_VALUE_STATE stateSnapshot()
+    {
+        ReadLocker locker(this, "projection");
+        return m_state;
+    }
+
+    AsyncValueType& m_parent;
+    Projection_t m_projection;
+    ComparePolicy_t m_compare;
+
+    // parent's value the projection reports (guarded by m_contentLock)
+    std::shared_ptr<ParentValueType> m_parentValue;
+    // the last projected value (or its hash) to compare with
+    // accessed in the parent's emitting thread only
+    AsyncCompareSnapshot<ValueType, ComparePolicy_t> m_lastValue;
+};
+
+template <typename ComparePolicy = AsyncComparePolicyEqual, typename AsyncValueType, typename Projection>
+std::unique_ptr<AsyncProjection<AsyncValueType, Projection, ComparePolicy>> asyncProjection(AsyncValueType& value, Projection projection)
+{
+    return std::make_unique<AsyncProjection<AsyncValueType, Projection, ComparePolicy>>(value, std::move(projection));
+}
+
+#endif // ASYNC_PROJECTION_H
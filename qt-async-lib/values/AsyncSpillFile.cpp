@@ -0,0 +1,198 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncSpillFile.h"
+#include <QTemporaryFile>
+
+AsyncSpillFile::AsyncSpillFile(const QString& fileName)
+{
+    if (fileName.isEmpty())
+    {
+        auto file = std::make_unique<QTemporaryFile>();
+        m_isOpen = file->open();
+        m_file = std::move(file);
+    }
+    else
+    {
+        m_file = std::make_unique<QFile>(fileName);
+        m_isOpen = m_file->open(QIODevice::ReadWrite | QIODevice::Truncate);
+    }
+}
+
+AsyncSpillFile::~AsyncSpillFile()
+{
+    Q_ASSERT(m_index.isEmpty() && "Spilled records are still referenced.");
+
+    QMutexLocker locker(&m_lock);
+    unmap();
+}
+
+bool AsyncSpillFile::isOpen() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_isOpen;
+}
+
+quint64 AsyncSpillFile::write(const QByteArray& data)
+{
+    QMutexLocker locker(&m_lock);
+
+    if (!m_isOpen || data.isEmpty())
+        return 0;
+
+    Record record;
+    record.offset = m_size;
+    record.size = data.size();
+
+    // reuse the first free range that fits
+    auto freeIt = m_freeRanges.begin();
+    for (; freeIt != m_freeRanges.end(); ++freeIt)
+    {
+        if (freeIt->second >= record.size)
+        {
+            record.offset = freeIt->first;
+            break;
+        }
+    }
+
+    if (!m_file->seek(record.offset) || m_file->write(data) != data.size() || !m_file->flush())
+    {
+        // drop partially appended record
+        if (freeIt == m_freeRanges.end())
+            m_file->resize(m_size);
+        return 0;
+    }
+
+    if (freeIt == m_freeRanges.end())
+    {
+        m_size += record.size;
+    }
+    else
+    {
+        auto rest = freeIt->second - record.size;
+        m_freeRanges.erase(freeIt);
+        if (rest > 0)
+            m_freeRanges.emplace(record.offset + record.size, rest);
+        m_garbageSize -= record.size;
+    }
+
+    auto id = m_nextId++;
+    m_index.insert(id, record);
+    return id;
+}
+
+QByteArray AsyncSpillFile::read(quint64 id)
+{
+    QMutexLocker locker(&m_lock);
+
+    auto it = m_index.find(id);
+    if (it == m_index.end())
+        return QByteArray();
+
+    auto record = it.value();
+
+    // map grown file again
+    if (record.offset + record.size > m_mapSize)
+    {
+        unmap();
+
+        m_map = m_file->map(0, m_size);
+        if (!m_map)
+            return QByteArray();
+
+        m_mapSize = m_size;
+    }
+
+    return QByteArray(reinterpret_cast<const char*>(m_map + record.offset), static_cast<int>(record.size));
+}
+
+void AsyncSpillFile::remove(quint64 id)
+{
+    QMutexLocker locker(&m_lock);
+
+    auto it = m_index.find(id);
+    if (it == m_index.end())
+        return;
+
+    auto record = it.value();
+    m_index.erase(it);
+
+    release(record.offset, record.size);
+}
+
+int AsyncSpillFile::recordCount() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_index.size();
+}
+
+qint64 AsyncSpillFile::size() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_size;
+}
+
+qint64 AsyncSpillFile::garbageSize() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_garbageSize;
+}
+
+void AsyncSpillFile::unmap()
+{
+    if (!m_map)
+        return;
+
+    m_file->unmap(m_map);
+    m_map = nullptr;
+    m_mapSize = 0;
+}
+
+void AsyncSpillFile::release(qint64 offset, qint64 size)
+{
+    m_garbageSize += size;
+
+    // merge with the next free range
+    auto nextIt = m_freeRanges.find(offset + size);
+    if (nextIt != m_freeRanges.end())
+    {
+        size += nextIt->second;
+        m_freeRanges.erase(nextIt);
+    }
+
+    // merge with the previous free range
+    auto it = m_freeRanges.emplace(offset, size).first;
+    if (it != m_freeRanges.begin())
+    {
+        auto prevIt = std::prev(it);
+        if (prevIt->first + prevIt->second == offset)
+        {
+            prevIt->second += size;
+            m_freeRanges.erase(it);
+            it = prevIt;
+        }
+    }
+
+    // truncate free tail of the file
+    if (it->first + it->second == m_size)
+    {
+        unmap();
+        m_file->resize(it->first);
+        m_size = it->first;
+        m_garbageSize -= it->second;
+        m_freeRanges.erase(it);
+    }
+}
@@ -0,0 +1,81 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_SPILL_FILE_H
+#define ASYNC_SPILL_FILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <map>
+#include <memory>
+
+// file for evicted content of async values
+// records are read back through the memory map
+// space of removed records is reused by new records, free tail is truncated
+class AsyncSpillFile
+{
+    Q_DISABLE_COPY(AsyncSpillFile)
+
+public:
+    // creates temporary file if fileName is empty
+    explicit AsyncSpillFile(const QString& fileName = QString());
+    ~AsyncSpillFile();
+
+    bool isOpen() const;
+
+    // writes record to the first free range that fits or appends it and returns its id
+    // returns 0 if record cannot be written
+    quint64 write(const QByteArray& data);
+    // returns data of the record
+    // returns null QByteArray if record cannot be read
+    QByteArray read(quint64 id);
+    void remove(quint64 id);
+
+    int recordCount() const;
+    qint64 size() const;
+    // size of free ranges
+    qint64 garbageSize() const;
+
+private:
+    // should be called under m_lock
+    void unmap();
+    // should be called under m_lock
+    void release(qint64 offset, qint64 size);
+
+    struct Record
+    {
+        qint64 offset = 0;
+        qint64 size = 0;
+    };
+
+    mutable QMutex m_lock;
+    std::unique_ptr<QFile> m_file;
+    bool m_isOpen = false;
+    QHash<quint64, Record> m_index;
+    quint64 m_nextId = 1;
+    qint64 m_size = 0;
+    qint64 m_garbageSize = 0;
+    // free ranges by offset, adjacent ranges are merged
+    std::map<qint64, qint64> m_freeRanges;
+
+    uchar* m_map = nullptr;
+    qint64 m_mapSize = 0;
+};
+
+#endif // ASYNC_SPILL_FILE_H
@@ -0,0 +1,164 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncStartupLoader.h"
+#include "AsyncValueBase.h"
+#include <algorithm>
+
+AsyncStartupLoader::AsyncStartupLoader(AsyncThreadPool* pool, QObject* parent)
+    : QObject(parent),
+      m_pool(pool),
+      m_category("startup")
+{
+}
+
+AsyncStartupLoader::~AsyncStartupLoader()
+{
+    requestStop();
+    wait();
+}
+
+void AsyncStartupLoader::setCategory(QString category)
+{
+    QMutexLocker locker(&m_lock);
+    m_category = std::move(category);
+}
+
+void AsyncStartupLoader::start()
+{
+    bool isFirstScreenEmpty = false;
+    QString category;
+
+    {
+        QMutexLocker locker(&m_lock);
+        Q_ASSERT(!m_isStarted && "Loader is already started.");
+        m_isStarted = true;
+        category = m_category;
+
+        // most visible values go to the pool first
+        std::stable_sort(m_items.begin(), m_items.end(), [](const Item& left, const Item& right) {
+            return left.visibility > right.visibility;
+        });
+
+        for (const auto& item : m_items)
+        {
+            if (item.isFirstScreen)
+                ++m_firstScreenPending;
+        }
+        m_pending = m_running = static_cast<int>(m_items.size());
+        isFirstScreenEmpty = (m_firstScreenPending == 0);
+    }
+
+    if (isFirstScreenEmpty)
+        emit firstScreenReady();
+
+    if (m_items.empty())
+    {
+        emit finished();
+        return;
+    }
+
+    for (const auto& item : m_items)
+    {
+        bool isFirstScreen = item.isFirstScreen;
+
+        // item is finished when its function is destroyed
+        // after the load or if it's dropped from the queue
+        std::shared_ptr<void> finished(nullptr, [this, isFirstScreen](void*) {
+            itemFinished(isFirstScreen);
+        });
+
+        // value is already in progress, wait for it instead
+        if (!item.start(finished, category))
+            waitForProgress(item, std::move(finished));
+    }
+}
+
+void AsyncStartupLoader::waitForProgress(const Item& item, std::shared_ptr<void> finished)
+{
+    struct Waiter
+    {
+        QMutex lock;
+        QMetaObject::Connection connection;
+        std::shared_ptr<void> finished;
+    };
+
+    auto waiter = std::make_shared<Waiter>();
+    waiter->finished = std::move(finished);
+
+    auto release = [](Waiter& waiter) {
+        // finish item outside the lock
+        std::shared_ptr<void> finished;
+        QMutexLocker locker(&waiter.lock);
+        QObject::disconnect(waiter.connection);
+        finished = std::move(waiter.finished);
+    };
+
+    {
+        QMutexLocker locker(&waiter->lock);
+        waiter->connection = QObject::connect(item.value, &AsyncValueBase::stateChanged, [waiter, release](ASYNC_VALUE_STATE state) {
+            if (state != ASYNC_VALUE_STATE::PROGRESS)
+                release(*waiter);
+        });
+    }
+
+    // progress could be completed before connection
+    if (!item.isInProgress())
+        release(*waiter);
+}
+
+void AsyncStartupLoader::requestStop()
+{
+    for (const auto& item : m_items)
+        item.requestStop();
+}
+
+void AsyncStartupLoader::wait()
+{
+    QMutexLocker locker(&m_lock);
+    while (m_running > 0)
+        m_itemFinished.wait(&m_lock);
+}
+
+bool AsyncStartupLoader::isFirstScreenReady() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_isStarted && m_firstScreenPending == 0;
+}
+
+void AsyncStartupLoader::itemFinished(bool isFirstScreen)
+{
+    bool isFirstScreenLoaded = false;
+    bool isAllLoaded = false;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        if (isFirstScreen)
+            isFirstScreenLoaded = (--m_firstScreenPending == 0);
+        isAllLoaded = (--m_pending == 0);
+    }
+
+    if (isFirstScreenLoaded)
+        emit firstScreenReady();
+    if (isAllLoaded)
+        emit finished();
+
+    // signals are emitted before destructor is unblocked
+    QMutexLocker locker(&m_lock);
+    --m_running;
+    m_itemFinished.wakeAll();
+}
@@ -0,0 +1,123 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_STARTUP_LOADER_H
+#define ASYNC_STARTUP_LOADER_H
+
+#include <QObject>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "AsyncProgress.h"
+#include "AsyncValueRunThreadPool.h"
+
+// warms up async values at application startup
+// values are loaded in the background in order of their visibility
+// firstScreenReady is emitted when all values of the first screen are loaded
+// values already in progress are not reloaded but waited for
+// NOTE: signals are emitted from worker threads
+// destructor stops and waits for all loads
+class AsyncStartupLoader : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(AsyncStartupLoader)
+
+public:
+    explicit AsyncStartupLoader(AsyncThreadPool* pool = AsyncThreadPool::globalInstance(), QObject* parent = nullptr);
+    ~AsyncStartupLoader() override;
+
+    // registers value to be loaded by start()
+    // values with higher visibility are loaded first
+    // func should read persisted or cached content into the value
+    template <typename AsyncValueType, typename Func>
+    void add(AsyncValueType& value, int visibility, Func&& func, bool isFirstScreen = true)
+    {
+        using ProgressType = typename AsyncValueType::ProgressType;
+
+        Item item;
+        item.visibility = visibility;
+        item.isFirstScreen = isFirstScreen;
+        item.value = &value;
+        item.start = [this, &value, visibility, func = std::forward<Func>(func)](std::shared_ptr<void> finished, const QString& category) {
+            AsyncTaskOptions options;
+            options.priority = visibility;
+            options.category = category;
+
+            return asyncValueRunThreadPool(m_pool, options, value, [finished, func](ProgressType& progress, AsyncValueType& value) {
+                func(progress, value);
+            }, QString("Loading..."), ASYNC_CAN_REQUEST_STOP::YES);
+        };
+        item.requestStop = [&value]() {
+            value.accessProgress([](ProgressType& progress) {
+                progress.requestStop();
+            });
+        };
+        item.isInProgress = [&value]() {
+            return value.accessProgress([](ProgressType&) {});
+        };
+
+        QMutexLocker locker(&m_lock);
+        Q_ASSERT(!m_isStarted && "Values should be added before start.");
+        m_items.push_back(std::move(item));
+    }
+
+    // category of loading tasks in the thread pool
+    void setCategory(QString category);
+
+    // starts loading of all added values
+    void start();
+    // requests stop of all loads
+    void requestStop();
+    // waits for all loads to complete
+    void wait();
+
+    bool isFirstScreenReady() const;
+
+signals:
+    // emitted once all first screen values are loaded
+    void firstScreenReady();
+    // emitted once all values are loaded
+    void finished();
+
+private:
+    void itemFinished(bool isFirstScreen);
+
+    struct Item
+    {
+        int visibility = 0;
+        bool isFirstScreen = true;
+        AsyncValueBase* value = nullptr;
+        std::function<bool(std::shared_ptr<void>, const QString&)> start;
+        std::function<void()> requestStop;
+        std::function<bool()> isInProgress;
+    };
+
+    // keeps item unfinished until its value leaves the progress started by someone else
+    static void waitForProgress(const Item& item, std::shared_ptr<void> finished);
+    std::vector<Item> m_items;
+
+    AsyncThreadPool* m_pool;
+    QString m_category;
+
+    mutable QMutex m_lock;
+    QWaitCondition m_itemFinished;
+    bool m_isStarted = false;
+    int m_firstScreenPending = 0;
+    int m_pending = 0;
+    int m_running = 0;
+};
+
+#endif // ASYNC_STARTUP_LOADER_H
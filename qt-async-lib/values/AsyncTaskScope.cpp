@@ -0,0 +1,82 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncTaskScope.h"
+
+AsyncTaskScope::~AsyncTaskScope()
+{
+    wait();
+}
+
+void AsyncTaskScope::requestStop()
+{
+    m_isStopRequested = true;
+
+    for (auto& child : m_children)
+        child.requestStop();
+}
+
+void AsyncTaskScope::wait()
+{
+    for (;;)
+    {
+        // propagate stop request from parent
+        if (!m_isStopRequested && m_isParentStopRequested())
+            requestStop();
+
+        updateParentProgress();
+
+        {
+            QMutexLocker locker(&m_lock);
+            if (m_running == 0)
+                break;
+        }
+
+        // let pool start another thread for children while we are blocked
+        // NOTE: children are not run here inline, otherwise stop requests cannot be propagated
+        AsyncThreadPool::BlockingRegion blocking;
+
+        QMutexLocker locker(&m_lock);
+        if (m_running > 0)
+            m_childFinished.wait(&m_lock, ASYNC_TASK_SCOPE_UPDATE_TIMEOUT);
+    }
+
+    // make sure children have completed their progresses
+    for (auto& child : m_children)
+        child.wait();
+
+    updateParentProgress();
+}
+
+void AsyncTaskScope::childFinished()
+{
+    QMutexLocker locker(&m_lock);
+
+    --m_running;
+    m_childFinished.wakeAll();
+}
+
+void AsyncTaskScope::updateParentProgress()
+{
+    if (m_children.empty())
+        return;
+
+    float progress = 0.f;
+    for (auto& child : m_children)
+        progress += child.progress();
+
+    m_setParentProgress(progress / m_children.size());
+}
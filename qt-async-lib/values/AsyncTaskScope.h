@@ -0,0 +1,128 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_TASK_SCOPE_H
+#define ASYNC_TASK_SCOPE_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../Config.h"
+#include "AsyncValueRunThreadPool.h"
+
+// runs child async values inside the parent's run function
+// stop requests of the parent progress are propagated to children
+// and children progresses are combined into the parent progress
+// destructor waits for all children to complete
+// NOTE: scope should be used from the parent's run function only
+class AsyncTaskScope
+{
+    Q_DISABLE_COPY(AsyncTaskScope)
+
+public:
+    template <typename ProgressType>
+    explicit AsyncTaskScope(ProgressType& parentProgress, AsyncThreadPool* pool = AsyncThreadPool::globalInstance())
+        : m_pool(pool)
+    {
+        m_isParentStopRequested = [&parentProgress]() {
+            return parentProgress.isStopRequested();
+        };
+        m_setParentProgress = [&parentProgress](float progress) {
+            parentProgress.setProgress(progress);
+        };
+    }
+
+    ~AsyncTaskScope();
+
+    template <typename AsyncValueType, typename Func, typename... ProgressArgs>
+    bool run(AsyncValueType& child, Func&& func, ProgressArgs&& ...progressArgs)
+    {
+        using ProgressType = typename AsyncValueType::ProgressType;
+
+        // don't start new children if parent is stopping
+        if (m_isParentStopRequested())
+            return false;
+
+        {
+            QMutexLocker locker(&m_lock);
+            ++m_running;
+        }
+
+        // child is finished when its function is destroyed
+        // after the run or if the task is not started or dropped from the queue
+        std::shared_ptr<void> finished(nullptr, [this](void*) {
+            childFinished();
+        });
+
+        bool isStarted = asyncValueRunThreadPool(m_pool, child, [finished, func = std::forward<Func>(func)](ProgressType& progress, AsyncValueType& value) {
+            func(progress, value);
+        }, std::forward<ProgressArgs>(progressArgs)...);
+
+        finished.reset();
+
+        if (!isStarted)
+            return false;
+
+        Child theChild;
+        theChild.progress = [&child]() {
+            float res = 1.f;
+            child.accessProgress([&res](ProgressType& progress) {
+                res = progress.progress();
+            });
+            return res;
+        };
+        theChild.requestStop = [&child]() {
+            child.accessProgress([](ProgressType& progress) {
+                progress.requestStop();
+            });
+        };
+        theChild.wait = [&child]() {
+            child.wait();
+        };
+
+        m_children.push_back(std::move(theChild));
+
+        return true;
+    }
+
+    // requests stop of all children
+    void requestStop();
+    // waits for all children to complete
+    void wait();
+
+private:
+    void childFinished();
+    void updateParentProgress();
+
+    struct Child
+    {
+        std::function<float()> progress;
+        std::function<void()> requestStop;
+        std::function<void()> wait;
+    };
+    std::vector<Child> m_children;
+
+    AsyncThreadPool* m_pool;
+    std::function<bool()> m_isParentStopRequested;
+    std::function<void(float)> m_setParentProgress;
+    bool m_isStopRequested = false;
+
+    QMutex m_lock;
+    QWaitCondition m_childFinished;
+    int m_running = 0;
+};
+
+#endif // ASYNC_TASK_SCOPE_H
@@ -0,0 +1,891 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncThreadPool.h"
+#include "AsyncValueBase.h"
+#include "../third_party/scope_exit.h"
+#include <limits>
+
+#if defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+static thread_local AsyncThreadPool* currentPool = nullptr;
+static thread_local int currentTaskPriority = std::numeric_limits<int>::max();
+// pool the current thread is pinned for
+static thread_local AsyncThreadPool* pinnedPool = nullptr;
+
+static void setCurrentThreadAffinity(const std::vector<int>& cpus)
+{
+#if defined(Q_OS_LINUX)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu : cpus)
+        CPU_SET(cpu, &cpuSet);
+
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#elif defined(Q_OS_WIN)
+    DWORD_PTR mask = 0;
+    for (auto cpu : cpus)
+    {
+        if (cpu < static_cast<int>(sizeof(mask) * 8))
+            mask |= DWORD_PTR(1) << cpu;
+    }
+
+    if (mask)
+        SetThreadAffinityMask(GetCurrentThread(), mask);
+#else
+    Q_UNUSED(cpus);
+#endif
+}
+
+// each task that can be started starts one ticket in QThreadPool
+// ticket runs the best queued task at the moment it gets a thread
+// or does nothing if the task was taken by a waiting thread
+class AsyncThreadPoolTicket : public QRunnable
+{
+public:
+    explicit AsyncThreadPoolTicket(AsyncThreadPool* pool)
+        : m_pool(pool)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        SCOPE_EXIT {
+            m_pool->ticketFinished();
+        };
+
+        m_pool->runTicket();
+    }
+
+private:
+    AsyncThreadPool* m_pool;
+};
+
+// calls deadline functions when deadlines expire
+// and lets thread pool start compensating threads for workers blocked too long
+class AsyncThreadPoolWatchdog : public QThread
+{
+public:
+    explicit AsyncThreadPoolWatchdog(AsyncThreadPool* pool)
+        : m_pool(pool)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        QMutexLocker locker(&m_pool->m_watchdogLock);
+
+        while (!m_pool->m_watchdogStop)
+        {
+            auto now = QDeadlineTimer::current().deadline();
+            auto nextWakeUp = std::numeric_limits<qint64>::max();
+
+            if (!m_pool->m_deadlines.empty())
+            {
+                auto it = m_pool->m_deadlines.begin();
+                if (it->first.deadline <= now)
+                {
+                    auto func = std::move(it->second);
+                    m_pool->m_deadlineIds.remove(it->first.id);
+                    m_pool->m_deadlines.erase(it);
+
+                    func();
+                    continue;
+                }
+
+                nextWakeUp = it->first.deadline;
+            }
+
+            for (auto& worker : m_pool->m_blockedWorkers)
+            {
+                auto& blocked = worker.second;
+                if (blocked.isCompensated)
+                    continue;
+
+                auto compensateTime = blocked.since + ASYNC_BLOCKED_WORKER_TIMEOUT;
+                if (compensateTime <= now)
+                {
+                    // let QThreadPool start one more thread while the worker is blocked
+                    blocked.isCompensated = true;
+                    m_pool->m_pool->releaseThread();
+                }
+                else
+                {
+                    nextWakeUp = qMin(nextWakeUp, compensateTime);
+                }
+            }
+
+            if (m_pool->m_autoTuneMax > 0)
+            {
+                if (m_pool->m_nextAutoTune <= now)
+                {
+                    m_pool->m_nextAutoTune = now + ASYNC_AUTO_TUNE_INTERVAL;
+
+                    // auto-tuning takes pool locks
+                    locker.unlock();
+                    m_pool->autoTune();
+                    locker.relock();
+                    continue;
+                }
+
+                nextWakeUp = qMin(nextWakeUp, m_pool->m_nextAutoTune);
+            }
+
+            if (nextWakeUp == std::numeric_limits<qint64>::max())
+                m_pool->m_watchdogChanged.wait(&m_pool->m_watchdogLock);
+            else
+                m_pool->m_watchdogChanged.wait(&m_pool->m_watchdogLock, static_cast<unsigned long>(qMin<qint64>(nextWakeUp - now, std::numeric_limits<int>::max())));
+        }
+    }
+
+private:
+    AsyncThreadPool* m_pool;
+};
+
+AsyncThreadPool::AsyncThreadPool(QThreadPool* pool)
+    : m_pool(pool)
+{
+    Q_ASSERT(m_pool);
+    m_clock.start();
+}
+
+AsyncThreadPool::~AsyncThreadPool()
+{
+    {
+        // tickets reference this object
+        QMutexLocker locker(&m_lock);
+        while (m_tickets > 0)
+            m_ticketsFinished.wait(&m_lock);
+    }
+
+    deleteFinishedThreads();
+
+    {
+        QMutexLocker locker(&m_watchdogLock);
+        m_watchdogStop = true;
+        m_watchdogChanged.wakeAll();
+    }
+
+    if (m_watchdog)
+        m_watchdog->wait();
+}
+
+AsyncThreadPool* AsyncThreadPool::globalInstance()
+{
+    static AsyncThreadPool instance(QThreadPool::globalInstance());
+    return &instance;
+}
+
+AsyncThreadPool* AsyncThreadPool::current()
+{
+    return currentPool;
+}
+
+int AsyncThreadPool::currentPriority()
+{
+    return currentTaskPriority;
+}
+
+AsyncThreadPool* AsyncThreadPool::blockingPool()
+{
+    QMutexLocker locker(&m_lock);
+
+    if (!m_blockingPool)
+    {
+        m_blockingThreadPool = std::make_unique<QThreadPool>();
+        m_blockingThreadPool->setMaxThreadCount(ASYNC_BLOCKING_POOL_MAX_THREADS);
+        m_blockingPool = std::make_unique<AsyncThreadPool>(m_blockingThreadPool.get());
+    }
+
+    return m_blockingPool.get();
+}
+
+void AsyncThreadPool::setThreadAffinity(int numaNode, std::vector<int> cpus)
+{
+    m_numaNode = numaNode;
+    m_cpus = std::move(cpus);
+}
+
+bool AsyncThreadPool::start(std::function<void()> task, AsyncValueBase* owner, AsyncTaskOptions options, std::function<void()> cancel)
+{
+    if (options.blocking)
+    {
+        // keep compute threads for CPU bound tasks
+        options.blocking = false;
+        return blockingPool()->start(std::move(task), owner, std::move(options), std::move(cancel));
+    }
+
+    Task theTask;
+    theTask.func = std::move(task);
+    theTask.owner = owner;
+    theTask.priority = options.priority;
+    theTask.cancel = std::move(cancel);
+    theTask.key = options.key;
+
+    auto duration = options.key.isEmpty() ? -1 : expectedDuration(options.key);
+    if (duration >= 0)
+    {
+        // hop to a pool thread costs more than a short task
+        // only pool threads run tasks inline, other threads (e.g. GUI thread)
+        // may have receivers which expect stateChanged to be queued
+        // NOTE: tasks cannot run inline from stateChanged handlers of their values
+        if (duration <= ASYNC_INLINE_TASK_MAX_DURATION_USEC && current() && !(owner && owner->isEmittingInCurrentThread()))
+        {
+            if (runUnqueued(theTask, options.category, false))
+                return true;
+        }
+
+        // long task shouldn't occupy pool thread
+        if (duration >= ASYNC_DEDICATED_THREAD_MIN_DURATION_USEC)
+        {
+            if (runUnqueued(theTask, options.category, true))
+                return true;
+        }
+    }
+
+    Task droppedTask;
+    SCOPE_EXIT {
+        // cancel outside the lock
+        if (droppedTask.cancel)
+            droppedTask.cancel();
+    };
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        auto queue = &m_queues[options.category];
+        theTask.queue = queue;
+
+        if (queue->isFull() && !makeRoom(*queue, droppedTask))
+        {
+            locker.unlock();
+
+            if (theTask.cancel)
+                theTask.cancel();
+
+            return false;
+        }
+
+        TaskKey key = { theTask.priority, options.deadline.deadline(), m_nextOrder++ };
+        theTask.queuedAt = m_clock.nsecsElapsed();
+
+        if (owner)
+        {
+            Q_ASSERT(!m_ownerTasks.contains(owner) && "Async value has queued task already");
+            m_ownerTasks.insert(owner, { queue, key });
+            owner->m_taskPool.storeRelease(this);
+        }
+
+        queue->tasks.emplace(key, std::move(theTask));
+        ++m_queueSize;
+    }
+
+    schedule();
+    return true;
+}
+
+bool AsyncThreadPool::runPendingTask(AsyncValueBase* owner)
+{
+    Q_ASSERT(owner);
+
+    Task task;
+
+    {
+        QMutexLocker locker(&m_lock);
+        if (!takeTask(owner, task))
+            return false;
+    }
+
+    runTask(task);
+    return true;
+}
+
+int AsyncThreadPool::queueSize() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_queueSize;
+}
+
+int AsyncThreadPool::queueSize(const QString& category) const
+{
+    QMutexLocker locker(&m_lock);
+
+    auto it = m_queues.find(category);
+    if (it == m_queues.end())
+        return 0;
+
+    return static_cast<int>(it->second.tasks.size());
+}
+
+qint64 AsyncThreadPool::expectedDuration(const QString& key) const
+{
+    QMutexLocker locker(&m_lock);
+
+    auto it = m_durations.find(key);
+    if (it == m_durations.end())
+        return -1;
+
+    return static_cast<qint64>(it.value());
+}
+
+void AsyncThreadPool::setExpectedDuration(const QString& key, qint64 duration)
+{
+    QMutexLocker locker(&m_lock);
+    m_durations.insert(key, static_cast<double>(duration));
+}
+
+bool AsyncThreadPool::setTaskPriority(AsyncValueBase* owner, int priority)
+{
+    QMutexLocker locker(&m_lock);
+    return setPriority(owner, priority, nullptr);
+}
+
+AsyncThreadPoolTelemetry AsyncThreadPool::telemetry() const
+{
+    AsyncThreadPoolTelemetry telemetry;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        telemetry.queueSize = m_queueSize;
+        for (const auto& category : m_queues)
+            telemetry.activeThreads += category.second.running;
+
+        telemetry.queueWaitTime = static_cast<qint64>(m_queueWaitTime);
+        telemetry.taskDuration = static_cast<qint64>(m_taskDuration);
+        telemetry.completedTasks = m_completedTasks;
+    }
+
+    {
+        QMutexLocker locker(&m_watchdogLock);
+        telemetry.blockedThreads = static_cast<int>(m_blockedWorkers.size());
+    }
+
+    telemetry.maxThreadCount = m_pool->maxThreadCount();
+    telemetry.idleThreads = qMax(0, telemetry.maxThreadCount - m_pool->activeThreadCount());
+
+    return telemetry;
+}
+
+void AsyncThreadPool::setAutoTune(int minThreadCount, int maxThreadCount)
+{
+    Q_ASSERT(minThreadCount <= maxThreadCount);
+
+    QMutexLocker locker(&m_watchdogLock);
+
+    m_autoTuneMin = qMax(1, minThreadCount);
+    m_autoTuneMax = maxThreadCount;
+    m_nextAutoTune = QDeadlineTimer::current().deadline();
+
+    if (m_autoTuneMax > 0)
+        startWatchdog();
+
+    m_watchdogChanged.wakeAll();
+}
+
+void AsyncThreadPool::setQueueLimit(const QString& category, int maxSize, ASYNC_QUEUE_OVERFLOW overflow, int blockTimeout)
+{
+    QMutexLocker locker(&m_lock);
+
+    auto& queue = m_queues[category];
+    queue.maxSize = maxSize;
+    queue.overflow = overflow;
+    queue.blockTimeout = blockTimeout;
+
+    // blocked producers should recheck the limit
+    m_queueChanged.wakeAll();
+}
+
+void AsyncThreadPool::setCategoryLimit(const QString& category, int maxThreadCount)
+{
+    {
+        QMutexLocker locker(&m_lock);
+        m_queues[category].limit = maxThreadCount;
+    }
+
+    // limit could be raised
+    schedule();
+}
+
+int AsyncThreadPool::categoryLimit(const QString& category) const
+{
+    QMutexLocker locker(&m_lock);
+
+    auto it = m_queues.find(category);
+    if (it == m_queues.end())
+        return 0;
+
+    return it->second.limit;
+}
+
+quint64 AsyncThreadPool::watchDeadline(QDeadlineTimer deadline, std::function<void()> func)
+{
+    Q_ASSERT(!deadline.isForever());
+
+    QMutexLocker locker(&m_watchdogLock);
+
+    startWatchdog();
+
+    DeadlineKey key = { deadline.deadline(), m_nextDeadlineId++ };
+    m_deadlines.emplace(key, std::move(func));
+    m_deadlineIds.insert(key.id, key.deadline);
+
+    // wake watchdog to recalculate the nearest deadline
+    m_watchdogChanged.wakeAll();
+
+    return key.id;
+}
+
+bool AsyncThreadPool::unwatchDeadline(quint64 id)
+{
+    QMutexLocker locker(&m_watchdogLock);
+
+    auto it = m_deadlineIds.find(id);
+    if (it == m_deadlineIds.end())
+        return false;
+
+    m_deadlines.erase({ it.value(), id });
+    m_deadlineIds.erase(it);
+    return true;
+}
+
+bool AsyncThreadPool::takeTask(AsyncValueBase* owner, Task& task)
+{
+    Queue* queue = nullptr;
+    std::map<TaskKey, Task>::iterator it;
+
+    if (owner)
+    {
+        auto ownerIt = m_ownerTasks.find(owner);
+        if (ownerIt == m_ownerTasks.end() || ownerIt.value().queue->runnableCount() == 0)
+            return false;
+
+        queue = ownerIt.value().queue;
+        it = queue->tasks.find(ownerIt.value().key);
+    }
+    else
+    {
+        // take the best task among categories under their limits
+        for (auto& category : m_queues)
+        {
+            auto& candidate = category.second;
+            if (candidate.runnableCount() == 0)
+                continue;
+
+            if (!queue || candidate.tasks.begin()->first < queue->tasks.begin()->first)
+                queue = &candidate;
+        }
+
+        if (!queue)
+            return false;
+
+        it = queue->tasks.begin();
+    }
+
+    task = removeTask(*queue, it);
+    ++queue->running;
+
+    auto queueWaitTime = (m_clock.nsecsElapsed() - task.queuedAt) / 1000.;
+    m_queueWaitTime += (queueWaitTime - m_queueWaitTime) / 8.;
+
+    return true;
+}
+
+AsyncThreadPool::Task AsyncThreadPool::removeTask(Queue& queue, std::map<TaskKey, Task>::iterator it)
+{
+    Task task = std::move(it->second);
+    queue.tasks.erase(it);
+    --m_queueSize;
+
+    if (task.owner)
+    {
+        m_ownerTasks.remove(task.owner);
+        task.owner->m_taskPool.storeRelease(nullptr);
+    }
+
+    m_queueChanged.wakeAll();
+
+    return task;
+}
+
+bool AsyncThreadPool::makeRoom(Queue& queue, Task& droppedTask)
+{
+    switch (queue.overflow)
+    {
+    case ASYNC_QUEUE_OVERFLOW::BLOCK:
+    {
+        QDeadlineTimer timeout(queue.blockTimeout);
+
+        // let pool start another thread while this one is blocked
+        BlockingRegion blocking;
+
+        while (queue.isFull())
+        {
+            if (timeout.hasExpired())
+                return false;
+
+            auto time = timeout.isForever() ? std::numeric_limits<unsigned long>::max() : static_cast<unsigned long>(timeout.remainingTime());
+            m_queueChanged.wait(&m_lock, time);
+        }
+
+        return true;
+    }
+
+    case ASYNC_QUEUE_OVERFLOW::REJECT:
+        return false;
+
+    case ASYNC_QUEUE_OVERFLOW::DROP_OLDEST:
+    {
+        auto oldestIt = queue.tasks.begin();
+        for (auto it = queue.tasks.begin(); it != queue.tasks.end(); ++it)
+        {
+            if (it->first.order < oldestIt->first.order)
+                oldestIt = it;
+        }
+
+        droppedTask = removeTask(queue, oldestIt);
+        return true;
+    }
+    }
+
+    return false;
+}
+
+bool AsyncThreadPool::setPriority(AsyncValueBase* owner, int priority, int* prevPriority)
+{
+    auto ownerIt = m_ownerTasks.find(owner);
+    if (ownerIt == m_ownerTasks.end())
+        return false;
+
+    auto& tasks = ownerIt.value().queue->tasks;
+    auto it = tasks.find(ownerIt.value().key);
+    Q_ASSERT(it != tasks.end());
+
+    if (prevPriority)
+        *prevPriority = it->second.priority;
+
+    // move task to the new position in the queue keeping its order
+    TaskKey newKey = { priority, it->first.deadline, it->first.order };
+    Task task = std::move(it->second);
+    task.priority = priority;
+
+    tasks.erase(it);
+    tasks.emplace(newKey, std::move(task));
+    ownerIt.value().key = newKey;
+
+    return true;
+}
+
+void AsyncThreadPool::runTask(Task& task, bool isInline)
+{
+    auto prevPool = currentPool;
+    auto prevPriority = currentTaskPriority;
+
+    // caller (e.g. GUI thread) doesn't hold a pool slot
+    // and shouldn't run pool tasks while waiting or lower its priority
+    if (!isInline)
+    {
+        currentPool = this;
+        currentTaskPriority = task.priority;
+    }
+
+    // follow-up tasks of the value will be run on the same node
+    if (m_numaNode >= 0 && task.owner)
+        task.owner->m_numaNode.storeRelease(m_numaNode);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    SCOPE_EXIT {
+        currentPool = prevPool;
+        currentTaskPriority = prevPriority;
+
+        {
+            QMutexLocker locker(&m_lock);
+            --task.queue->running;
+
+            auto duration = timer.nsecsElapsed() / 1000.;
+            m_taskDuration += (duration - m_taskDuration) / 8.;
+            ++m_completedTasks;
+
+            if (!task.key.isEmpty())
+            {
+                auto it = m_durations.find(task.key);
+                if (it == m_durations.end())
+                    m_durations.insert(task.key, duration);
+                else // exponential moving average
+                    it.value() += (duration - it.value()) / 8.;
+            }
+        }
+
+        // category limit may allow to start more tasks
+        schedule();
+    };
+
+    task.func();
+}
+
+bool AsyncThreadPool::runUnqueued(Task& task, const QString& category, bool isDedicated)
+{
+    {
+        QMutexLocker locker(&m_lock);
+
+        auto queue = &m_queues[category];
+
+        // the same admission as for queued tasks
+        // don't exceed category limit and don't overtake queued tasks
+        if (!queue->tasks.empty() || (queue->limit > 0 && queue->running >= queue->limit))
+            return false;
+
+        task.queue = queue;
+        ++task.queue->running;
+
+        // destructor waits for dedicated threads like for tickets
+        if (isDedicated)
+            ++m_tickets;
+    }
+
+    if (!isDedicated)
+    {
+        runTask(task, true);
+        return true;
+    }
+
+    deleteFinishedThreads();
+
+    auto thread = QThread::create([this, task]() mutable {
+        SCOPE_EXIT {
+            // thread is deleted by the pool after it finishes
+            {
+                QMutexLocker locker(&m_lock);
+                m_finishedThreads.push_back(QThread::currentThread());
+            }
+
+            ticketFinished();
+        };
+
+        pinCurrentThread();
+        runTask(task);
+    });
+
+    thread->start();
+    return true;
+}
+
+void AsyncThreadPool::deleteFinishedThreads()
+{
+    std::vector<QThread*> threads;
+
+    {
+        QMutexLocker locker(&m_lock);
+        threads.swap(m_finishedThreads);
+    }
+
+    for (auto thread : threads)
+    {
+        thread->wait();
+        delete thread;
+    }
+}
+
+void AsyncThreadPool::schedule()
+{
+    int newTickets = 0;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        int runnableCount = 0;
+        for (const auto& category : m_queues)
+            runnableCount += category.second.runnableCount();
+
+        newTickets = runnableCount - m_pendingTickets;
+        if (newTickets <= 0)
+            return;
+
+        m_pendingTickets += newTickets;
+        m_tickets += newTickets;
+    }
+
+    for (int i = 0; i < newTickets; ++i)
+        m_pool->start(new AsyncThreadPoolTicket(this));
+}
+
+void AsyncThreadPool::runTicket()
+{
+    Task task;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        --m_pendingTickets;
+        if (!takeTask(nullptr, task))
+            return;
+    }
+
+    pinCurrentThread();
+    runTask(task);
+}
+
+void AsyncThreadPool::pinCurrentThread()
+{
+    if (m_cpus.empty() || pinnedPool == this)
+        return;
+
+    setCurrentThreadAffinity(m_cpus);
+    pinnedPool = this;
+}
+
+void AsyncThreadPool::startWatchdog()
+{
+    if (!m_watchdog)
+    {
+        m_watchdog = std::make_unique<AsyncThreadPoolWatchdog>(this);
+        m_watchdog->start();
+    }
+}
+
+quint64 AsyncThreadPool::enterBlocking()
+{
+    QMutexLocker locker(&m_watchdogLock);
+
+    startWatchdog();
+
+    auto id = m_nextBlockedId++;
+    m_blockedWorkers.emplace(id, BlockedWorker{ QDeadlineTimer::current().deadline(), false });
+
+    // wake watchdog to recalculate the nearest compensation
+    m_watchdogChanged.wakeAll();
+
+    return id;
+}
+
+void AsyncThreadPool::leaveBlocking(quint64 id)
+{
+    bool isCompensated = false;
+
+    {
+        QMutexLocker locker(&m_watchdogLock);
+
+        auto it = m_blockedWorkers.find(id);
+        Q_ASSERT(it != m_blockedWorkers.end());
+
+        isCompensated = it->second.isCompensated;
+        m_blockedWorkers.erase(it);
+    }
+
+    // take back the compensating thread
+    if (isCompensated)
+        m_pool->reserveThread();
+}
+
+void AsyncThreadPool::autoTune()
+{
+    int minThreadCount = 0;
+    int maxThreadCount = 0;
+
+    {
+        QMutexLocker locker(&m_watchdogLock);
+        minThreadCount = m_autoTuneMin;
+        maxThreadCount = m_autoTuneMax;
+    }
+
+    if (maxThreadCount <= 0)
+        return;
+
+    auto state = telemetry();
+    auto threadCount = state.maxThreadCount;
+
+    if (state.queueSize > 0 && state.idleThreads == 0 && state.queueWaitTime > state.taskDuration)
+    {
+        // tasks wait in the queue longer than they run
+        ++threadCount;
+    }
+    else if (state.queueSize == 0 && state.idleThreads > 0)
+    {
+        // nothing to do for spare threads
+        --threadCount;
+    }
+
+    threadCount = qBound(minThreadCount, threadCount, maxThreadCount);
+    if (threadCount != state.maxThreadCount)
+        m_pool->setMaxThreadCount(threadCount);
+}
+
+void AsyncThreadPool::ticketFinished()
+{
+    QMutexLocker locker(&m_lock);
+
+    --m_tickets;
+    if (m_tickets == 0)
+        m_ticketsFinished.wakeAll();
+}
+
+AsyncThreadPool::BlockingRegion::BlockingRegion()
+    : m_pool(currentPool)
+{
+    if (m_pool)
+        m_id = m_pool->enterBlocking();
+}
+
+AsyncThreadPool::BlockingRegion::~BlockingRegion()
+{
+    if (m_pool)
+        m_pool->leaveBlocking(m_id);
+}
+
+AsyncThreadPool::PriorityInheritance::PriorityInheritance(AsyncValueBase* owner)
+    : m_owner(owner)
+{
+    auto pool = m_owner->m_taskPool.loadAcquire();
+    if (!pool)
+        return;
+
+    m_priority = currentPriority();
+
+    QMutexLocker locker(&pool->m_lock);
+
+    int prevPriority = 0;
+    auto ownerIt = pool->m_ownerTasks.find(m_owner);
+    if (ownerIt == pool->m_ownerTasks.end() || ownerIt.value().key.priority >= m_priority)
+        return;
+
+    if (pool->setPriority(m_owner, m_priority, &prevPriority))
+    {
+        m_pool = pool;
+        m_prevPriority = prevPriority;
+    }
+}
+
+AsyncThreadPool::PriorityInheritance::~PriorityInheritance()
+{
+    if (!m_pool)
+        return;
+
+    QMutexLocker locker(&m_pool->m_lock);
+
+    // restore priority if nobody else has changed it
+    auto ownerIt = m_pool->m_ownerTasks.find(m_owner);
+    if (ownerIt != m_pool->m_ownerTasks.end() && ownerIt.value().key.priority == m_priority)
+        m_pool->setPriority(m_owner, m_prevPriority, nullptr);
+}
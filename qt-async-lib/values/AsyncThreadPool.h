@@ -0,0 +1,347 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_THREAD_POOL_H
+#define ASYNC_THREAD_POOL_H
+
+#include "../Config.h"
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <map>
+#include <vector>
+#include <memory>
+#include <functional>
+
+class QThread;
+class AsyncValueBase;
+class AsyncThreadPoolWatchdog;
+
+struct AsyncTaskOptions
+{
+    // tasks with higher priority are run first
+    int priority = 0;
+    // tasks with equal priority are run in the earliest deadline first order
+    // stop is requested when the deadline expires
+    QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever);
+    // tasks of a category are queued separately
+    // and run in no more threads than the category limit
+    QString category;
+    // task mostly waits for I/O and is run in the blocking pool
+    bool blocking = false;
+    // tasks with the same key are expected to run similar time
+    // expected short tasks started from pool threads are run inline
+    // and long ones in dedicated threads
+    QString key;
+};
+
+struct AsyncThreadPoolTelemetry
+{
+    int queueSize = 0;
+    // threads running tasks
+    int activeThreads = 0;
+    // threads waiting in blocking regions
+    int blockedThreads = 0;
+    // threads the pool can start or reuse for new tasks
+    int idleThreads = 0;
+    int maxThreadCount = 0;
+    // moving averages in microseconds
+    qint64 queueWaitTime = 0;
+    qint64 taskDuration = 0;
+    quint64 completedTasks = 0;
+};
+
+// what to do when a task is queued to the full queue
+enum class ASYNC_QUEUE_OVERFLOW
+{
+    // wait until queue has room
+    BLOCK,
+    // reject the new task
+    REJECT,
+    // drop the oldest queued task
+    DROP_OLDEST
+};
+
+// keeps queue of tasks and runs them in QThreadPool
+// threads waiting for async values inside tasks run the awaited queued tasks themselves
+class AsyncThreadPool
+{
+    Q_DISABLE_COPY(AsyncThreadPool)
+
+public:
+    explicit AsyncThreadPool(QThreadPool* pool);
+    ~AsyncThreadPool();
+
+    static AsyncThreadPool* globalInstance();
+    // returns pool that runs task in the current thread or nullptr
+    static AsyncThreadPool* current();
+    // returns priority of the task running in the current thread
+    // threads not owned by async pools have the highest priority
+    static int currentPriority();
+
+    QThreadPool* threadPool() const { return m_pool; }
+    // pool for blocking tasks
+    AsyncThreadPool* blockingPool();
+
+    // pins pool threads to the cpus of the NUMA node
+    // async values calculated in the pool remember the node
+    // NOTE: should be called before the pool is used
+    void setThreadAffinity(int numaNode, std::vector<int> cpus);
+    // returns NUMA node of the pool or -1
+    int numaNode() const { return m_numaNode; }
+
+    // queues task that calculates owner async value
+    // cancel is called instead of the task if the task is rejected or dropped from the queue
+    // returns false if the task is rejected
+    bool start(std::function<void()> task, AsyncValueBase* owner = nullptr, AsyncTaskOptions options = AsyncTaskOptions(), std::function<void()> cancel = nullptr);
+
+    // takes queued task of the owner and runs it in the current thread
+    // NOTE: other tasks are never taken, they could wait for the caller further down the stack
+    // returns false if owner has no queued task that can be run now
+    bool runPendingTask(AsyncValueBase* owner);
+
+    int queueSize() const;
+    int queueSize(const QString& category) const;
+
+    // returns moving average of durations of tasks with the key in microseconds
+    // or -1 if no tasks with the key have been run yet
+    qint64 expectedDuration(const QString& key) const;
+    // seeds expected duration of tasks with the key (e.g. from the previous session)
+    void setExpectedDuration(const QString& key, qint64 duration);
+
+    // returns current state and statistics of the pool
+    AsyncThreadPoolTelemetry telemetry() const;
+    // lets watchdog adjust thread count of the pool within the bounds
+    // every ASYNC_AUTO_TUNE_INTERVAL msecs, zero maxThreadCount disables auto-tuning
+    void setAutoTune(int minThreadCount, int maxThreadCount);
+
+    // limits number of queued tasks of the category
+    // zero means no limit, blockTimeout -1 means waiting forever
+    void setQueueLimit(const QString& category, int maxSize, ASYNC_QUEUE_OVERFLOW overflow = ASYNC_QUEUE_OVERFLOW::BLOCK, int blockTimeout = -1);
+
+    // limits number of threads running tasks of the category simultaneously
+    // zero means no limit
+    void setCategoryLimit(const QString& category, int maxThreadCount);
+    int categoryLimit(const QString& category) const;
+
+    // changes priority of the owner's queued task
+    // returns false if the task is not queued
+    bool setTaskPriority(AsyncValueBase* owner, int priority);
+
+    // calls func in the watchdog thread when the deadline expires
+    // returns id for unwatchDeadline
+    quint64 watchDeadline(QDeadlineTimer deadline, std::function<void()> func);
+    // returns false if func has been called already
+    // func is not running when unwatchDeadline returns
+    bool unwatchDeadline(quint64 id);
+
+    // marks the current pool thread as blocked
+    // if the thread is blocked longer than ASYNC_BLOCKED_WORKER_TIMEOUT
+    // watchdog lets thread pool start compensating thread for queued tasks
+    class BlockingRegion
+    {
+        Q_DISABLE_COPY(BlockingRegion)
+
+    public:
+        BlockingRegion();
+        ~BlockingRegion();
+
+    private:
+        AsyncThreadPool* m_pool;
+        quint64 m_id = 0;
+    };
+
+    // raises priority of the owner's queued task to the priority of the current thread
+    // priority is restored on destruction if the task is still queued
+    class PriorityInheritance
+    {
+        Q_DISABLE_COPY(PriorityInheritance)
+
+    public:
+        explicit PriorityInheritance(AsyncValueBase* owner);
+        ~PriorityInheritance();
+
+    private:
+        AsyncThreadPool* m_pool = nullptr;
+        AsyncValueBase* m_owner;
+        int m_priority = 0;
+        int m_prevPriority = 0;
+    };
+
+private:
+    friend class AsyncThreadPoolTicket;
+    friend class AsyncThreadPoolWatchdog;
+
+    struct TaskKey
+    {
+        int priority;
+        // QDeadlineTimer::deadline() that is max for tasks without deadline
+        qint64 deadline;
+        quint64 order;
+
+        bool operator<(const TaskKey& other) const
+        {
+            if (priority != other.priority)
+                return priority > other.priority;
+
+            if (deadline != other.deadline)
+                return deadline < other.deadline;
+
+            return order < other.order;
+        }
+    };
+
+    struct Queue;
+
+    struct Task
+    {
+        std::function<void()> func;
+        AsyncValueBase* owner = nullptr;
+        int priority = 0;
+        Queue* queue = nullptr;
+        std::function<void()> cancel;
+        QString key;
+        // m_clock time when the task was queued
+        qint64 queuedAt = 0;
+    };
+
+    // queue of one category
+    struct Queue
+    {
+        std::map<TaskKey, Task> tasks;
+        int limit = 0;
+        int running = 0;
+
+        int maxSize = 0;
+        ASYNC_QUEUE_OVERFLOW overflow = ASYNC_QUEUE_OVERFLOW::BLOCK;
+        int blockTimeout = -1;
+
+        bool isFull() const { return maxSize > 0 && static_cast<int>(tasks.size()) >= maxSize; }
+
+        // number of tasks that can be started now
+        int runnableCount() const
+        {
+            auto count = static_cast<int>(tasks.size());
+            if (limit > 0)
+                count = qMin(count, qMax(0, limit - running));
+            return count;
+        }
+    };
+
+    struct OwnerTask
+    {
+        Queue* queue;
+        TaskKey key;
+    };
+
+    // takes the best runnable task or only the owner's task if owner is set
+    // should be called under m_lock
+    bool takeTask(AsyncValueBase* owner, Task& task);
+    // should be called under m_lock
+    Task removeTask(Queue& queue, std::map<TaskKey, Task>::iterator it);
+    // makes room in the full queue according to its overflow policy
+    // returns false if the new task should be rejected
+    // should be called under m_lock
+    bool makeRoom(Queue& queue, Task& droppedTask);
+    // should be called under m_lock
+    bool setPriority(AsyncValueBase* owner, int priority, int* prevPriority);
+    // inline tasks don't make the calling thread look like a pool thread
+    void runTask(Task& task, bool isInline = false);
+    // runs task bypassing the queue inline or in a dedicated thread
+    // returns false if the category is at its limit or has queued tasks
+    bool runUnqueued(Task& task, const QString& category, bool isDedicated);
+    // deletes finished dedicated threads
+    void deleteFinishedThreads();
+    // starts tickets for tasks that can be run now
+    void schedule();
+    void runTicket();
+    void ticketFinished();
+    void startWatchdog();
+    void pinCurrentThread();
+    void autoTune();
+    quint64 enterBlocking();
+    void leaveBlocking(quint64 id);
+
+    QThreadPool* m_pool;
+    int m_numaNode = -1;
+    std::vector<int> m_cpus;
+
+    mutable QMutex m_lock;
+    // queues by categories (never removed)
+    std::map<QString, Queue> m_queues;
+    int m_queueSize = 0;
+    // queued tasks of async values
+    QHash<AsyncValueBase*, OwnerTask> m_ownerTasks;
+    quint64 m_nextOrder = 0;
+    // moving averages of task durations by keys
+    QHash<QString, double> m_durations;
+    QElapsedTimer m_clock;
+    double m_queueWaitTime = 0.;
+    double m_taskDuration = 0.;
+    quint64 m_completedTasks = 0;
+    // number of tickets started in QThreadPool but not finished yet
+    int m_tickets = 0;
+    // number of tickets waiting for a thread in QThreadPool
+    int m_pendingTickets = 0;
+    QWaitCondition m_ticketsFinished;
+    // dedicated threads that have run their tasks
+    std::vector<QThread*> m_finishedThreads;
+    // signals that tasks were taken from queues
+    QWaitCondition m_queueChanged;
+
+    struct DeadlineKey
+    {
+        qint64 deadline;
+        quint64 id;
+
+        bool operator<(const DeadlineKey& other) const
+        {
+            if (deadline != other.deadline)
+                return deadline < other.deadline;
+
+            return id < other.id;
+        }
+    };
+
+    struct BlockedWorker
+    {
+        qint64 since;
+        bool isCompensated;
+    };
+
+    // watchdog calls deadline functions and compensates blocked workers under m_watchdogLock
+    mutable QMutex m_watchdogLock;
+    QWaitCondition m_watchdogChanged;
+    std::map<DeadlineKey, std::function<void()>> m_deadlines;
+    QHash<quint64, qint64> m_deadlineIds;
+    quint64 m_nextDeadlineId = 1;
+    std::map<quint64, BlockedWorker> m_blockedWorkers;
+    quint64 m_nextBlockedId = 1;
+    int m_autoTuneMin = 0;
+    int m_autoTuneMax = 0;
+    qint64 m_nextAutoTune = 0;
+    bool m_watchdogStop = false;
+    std::unique_ptr<AsyncThreadPoolWatchdog> m_watchdog;
+
+    std::unique_ptr<QThreadPool> m_blockingThreadPool;
+    std::unique_ptr<AsyncThreadPool> m_blockingPool;
+};
+
+#endif // ASYNC_THREAD_POOL_H
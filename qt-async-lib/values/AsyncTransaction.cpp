@@ -0,0 +1,132 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncTransaction.h"
+#include <memory>
+
+AsyncTransaction::AsyncTransaction(QObject* parent)
+    : QObject(parent)
+{
+}
+
+bool AsyncTransaction::commit()
+{
+    if (m_stages.empty())
+        return true;
+
+    std::vector<AsyncValueBase*> values;
+    for (const auto& stage : m_stages)
+        values.push_back(stage.value);
+
+    // lock values in the same order to avoid deadlocks
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    for (auto value : values)
+    {
+        if (value->isEmittingInCurrentThread())
+        {
+            Q_ASSERT(false && "Cannot commit transaction from stateChanged handler of the participating value");
+            return false;
+        }
+    }
+
+    // stages keep old content until all values are unlocked
+    auto stages = std::move(m_stages);
+    m_stages.clear();
+
+    {
+        std::vector<std::unique_ptr<AsyncValueBase::WriteLocker>> writeLockers;
+        for (auto value : values)
+            writeLockers.push_back(std::make_unique<AsyncValueBase::WriteLocker>(value, "commit"));
+
+        SCOPE_EXIT {
+            while (!writeLockers.empty())
+                writeLockers.pop_back();
+        };
+
+        // publish all content at once
+        {
+            for (auto value : values)
+                value->m_contentLock.lockForWrite();
+
+            SCOPE_EXIT {
+                for (auto it = values.rbegin(); it != values.rend(); ++it)
+                    (*it)->m_contentLock.unlock();
+            };
+
+            for (auto& stage : stages)
+                stage.isChanged = stage.publish();
+        }
+
+        // treat all values as emitting
+        // so changes from stateChanged handlers are deferred instead of deadlocking
+        for (auto value : values)
+            value->m_emitThread.storeRelease(QThread::currentThread());
+
+        SCOPE_EXIT {
+            for (auto value : values)
+                value->m_emitThread.storeRelease(nullptr);
+        };
+
+        // notify observers once per changed value
+        for (auto value : values)
+        {
+            auto it = std::find_if(stages.begin(), stages.end(), [value](const Stage& stage) {
+                return stage.value == value && stage.isChanged;
+            });
+
+            if (it != stages.end())
+                it->notify();
+        }
+
+        // apply changes made by observers
+        for (bool hasPendingMutations = true; hasPendingMutations; )
+        {
+            hasPendingMutations = false;
+
+            for (auto value : values)
+            {
+                if (value->m_pendingMutations.empty())
+                    continue;
+
+                hasPendingMutations = true;
+                value->runPendingMutations();
+            }
+        }
+    }
+
+    emit committed();
+
+    return true;
+}
+
+void AsyncTransaction::rollback()
+{
+    m_stages.clear();
+}
+
+void AsyncTransaction::stage(AsyncValueBase* value, std::function<bool()> publish, std::function<void()> notify)
+{
+    Q_ASSERT(value);
+
+    Stage stage;
+    stage.value = value;
+    stage.publish = std::move(publish);
+    stage.notify = std::move(notify);
+
+    m_stages.push_back(std::move(stage));
+}
@@ -0,0 +1,136 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_TRANSACTION_H
+#define ASYNC_TRANSACTION_H
+
+#include "AsyncValueTemplate.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class AsyncTransaction : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(AsyncTransaction)
+
+public:
+    explicit AsyncTransaction(QObject* parent = nullptr);
+
+    template <typename AsyncValueType, typename... Args>
+    void emplaceValue(AsyncValueType& value, Args&& ...arguments)
+    {
+        shareValue(value, std::make_shared<typename AsyncValueType::ValueType>(std::forward<Args>(arguments)...));
+    }
+
+    template <typename AsyncValueType>
+    void moveValue(AsyncValueType& value, std::unique_ptr<typename AsyncValueType::ValueType> newValue)
+    {
+        shareValue(value, std::shared_ptr<typename AsyncValueType::ValueType>(std::move(newValue)));
+    }
+
+    template <typename AsyncValueType>
+    void shareValue(AsyncValueType& value, std::shared_ptr<typename AsyncValueType::ValueType> newValue)
+    {
+        using ContentType = typename AsyncValueType::Content;
+
+        // old content is released after all values are unlocked
+        auto oldContent = std::make_shared<ContentType>();
+
+        stage(&value, [&value, newValue, oldContent]() {
+            return value.assignValue(newValue, *oldContent);
+        }, [&value]() {
+            value.notifyStateChanged();
+        });
+    }
+
+    template <typename AsyncValueType, typename... Args>
+    void emplaceError(AsyncValueType& value, Args&& ...arguments)
+    {
+        moveError(value, std::make_unique<typename AsyncValueType::ErrorType>(std::forward<Args>(arguments)...));
+    }
+
+    template <typename AsyncValueType>
+    void moveError(AsyncValueType& value, std::unique_ptr<typename AsyncValueType::ErrorType> newError)
+    {
+        using ContentType = typename AsyncValueType::Content;
+
+        auto errorHolder = std::make_shared<std::unique_ptr<typename AsyncValueType::ErrorType>>(std::move(newError));
+        // old content is released after all values are unlocked
+        auto oldContent = std::make_shared<ContentType>();
+
+        stage(&value, [&value, errorHolder, oldContent]() {
+            return value.assignError(std::move(*errorHolder), *oldContent);
+        }, [&value]() {
+            value.notifyStateChanged();
+        });
+    }
+
+    // publishes all staged content at once
+    // observers of each changed value are notified after all values are published
+    // returns false if transaction cannot be committed
+    bool commit();
+    // drops all staged content
+    void rollback();
+
+    // calls func with values of all async values under the consistent snapshot
+    // returns false if some of async values have no value
+    template <typename Func, typename... AsyncValueTypes>
+    static bool accessValues(Func&& func, AsyncValueTypes& ...values)
+    {
+        // bring evicted values back to memory before the snapshot
+        (void)std::initializer_list<int>{ (values.restoreValue(), 0)... };
+
+        std::vector<AsyncValueBase*> sortedValues = { &values... };
+        // lock values in the same order to avoid deadlocks
+        std::sort(sortedValues.begin(), sortedValues.end());
+        sortedValues.erase(std::unique(sortedValues.begin(), sortedValues.end()), sortedValues.end());
+
+        std::vector<std::unique_ptr<AsyncValueBase::ReadLocker>> readLockers;
+        for (auto value : sortedValues)
+            readLockers.push_back(std::make_unique<AsyncValueBase::ReadLocker>(value, "accessValues"));
+
+        bool hasValues = true;
+        for (auto isValue : { (values.m_state == ASYNC_VALUE_STATE::VALUE && values.m_content.value != nullptr)... })
+            hasValues = hasValues && isValue;
+
+        if (!hasValues)
+            return false;
+
+        func(*values.m_content.value...);
+        return true;
+    }
+
+signals:
+    // emitted once per committed transaction
+    void committed();
+
+private:
+    // publish is called under value's m_writeLock and m_contentLock
+    // notify is called under value's m_writeLock
+    void stage(AsyncValueBase* value, std::function<bool()> publish, std::function<void()> notify);
+
+    struct Stage
+    {
+        AsyncValueBase* value;
+        std::function<bool()> publish;
+        std::function<void()> notify;
+        bool isChanged = false;
+    };
+    std::vector<Stage> m_stages;
+};
+
+#endif // ASYNC_TRANSACTION_H
@@ -27,3 +27,14 @@ AsyncValueBase::AsyncValueBase(ASYNC_VALUE_STATE state, QObject* parent)
 {
 }
 
+void AsyncValueBase::runPendingMutations()
+{
+    // mutations can queue new mutations while being applied
+    while (!m_pendingMutations.empty())
+    {
+        auto mutation = std::move(m_pendingMutations.front());
+        m_pendingMutations.pop_front();
+
+        mutation();
+    }
+}
@@ -19,11 +19,17 @@
 
 #include "../Config.h"
 #include "../third_party/scope_exit.h"
+#include "AsyncBlockingDetector.h"
 #include <QObject>
 #include <QMutex>
 #include <QReadWriteLock>
 #include <QWaitCondition>
 #include <QThread>
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QDeadlineTimer>
+#include <deque>
+#include <functional>
 
 enum class ASYNC_VALUE_STATE
 {
@@ -33,17 +39,173 @@ enum class ASYNC_VALUE_STATE
 };
 Q_DECLARE_METATYPE(ASYNC_VALUE_STATE);
 
+class AsyncTransaction;
+class AsyncThreadPool;
+class AsyncNumaPools;
+class AsyncEmitProfiler;
+class AsyncBlockingDetector;
+
 class AsyncValueBase : public QObject
 {
     Q_OBJECT
     Q_DISABLE_COPY(AsyncValueBase)
 
+    friend class AsyncTransaction;
+    friend class AsyncThreadPool;
+    friend class AsyncNumaPools;
+    friend class AsyncEmitProfiler;
+    friend class AsyncBlockingDetector;
+
 signals:
     void stateChanged(ASYNC_VALUE_STATE state);
 
+public:
+    // marks the current thread as calculating the value (diagnostics only)
+    // launchers create it in the thread that runs the calculation
+    class CalculationThread
+    {
+        Q_DISABLE_COPY(CalculationThread)
+
+    public:
+        explicit CalculationThread(AsyncValueBase& value)
+            : m_value(value)
+        {
+            m_value.m_calculationThread.storeRelease(QThread::currentThreadId());
+        }
+
+        ~CalculationThread()
+        {
+            m_value.m_calculationThread.storeRelease(nullptr);
+        }
+
+    private:
+        AsyncValueBase& m_value;
+    };
+
 protected:
     explicit AsyncValueBase(ASYNC_VALUE_STATE state, QObject* parent = nullptr);
 
+    // returns true if stateChanged signal is emitting in the current thread
+    bool isEmittingInCurrentThread() const { return m_emitThread.loadAcquire() == QThread::currentThread(); }
+    // returns true if m_writeLock is locked by the current thread
+    bool isWriteLockedInCurrentThread() const { return m_writeLockOwner.loadAcquire() == QThread::currentThreadId(); }
+    // applies mutations deferred from stateChanged handlers
+    // should be called under m_writeLock
+    void runPendingMutations();
+    // locks m_writeLock and remembers the owner thread
+    // measures blocking of the GUI thread if lock is busy
+    class WriteLocker
+    {
+        Q_DISABLE_COPY(WriteLocker)
+
+    public:
+        WriteLocker(AsyncValueBase* value, const char* api)
+            : m_value(value)
+        {
+            if (!m_value->m_writeLock.tryLock())
+            {
+                AsyncBlockingDetector::Block block(m_value, api);
+                m_value->m_writeLock.lock();
+            }
+
+            m_value->m_writeLockOwner.storeRelease(QThread::currentThreadId());
+        }
+
+        ~WriteLocker()
+        {
+            m_value->m_writeLockOwner.storeRelease(nullptr);
+            m_value->m_writeLock.unlock();
+        }
+
+    private:
+        AsyncValueBase* m_value;
+    };
+
+    // locks m_contentLock for read
+    // measures blocking of the GUI thread if lock is busy
+    class ReadLocker
+    {
+        Q_DISABLE_COPY(ReadLocker)
+
+    public:
+        ReadLocker(AsyncValueBase* value, const char* api)
+            : m_value(value),
+              m_api(api)
+        {
+            relock();
+        }
+
+        ~ReadLocker()
+        {
+            if (m_isLocked)
+                unlock();
+        }
+
+        void unlock()
+        {
+            m_value->m_contentLock.unlock();
+            m_isLocked = false;
+        }
+
+        void relock()
+        {
+            if (!m_value->m_contentLock.tryLockForRead())
+            {
+                AsyncBlockingDetector::Block block(m_value, m_api);
+                m_value->m_contentLock.lockForRead();
+            }
+
+            m_isLocked = true;
+        }
+
+    private:
+        AsyncValueBase* m_value;
+        const char* m_api;
+        bool m_isLocked = false;
+    };
+
+    // locks m_contentLock for write
+    // measures blocking of the GUI thread if lock is busy
+    class ContentWriteLocker
+    {
+        Q_DISABLE_COPY(ContentWriteLocker)
+
+    public:
+        ContentWriteLocker(AsyncValueBase* value, const char* api)
+            : m_value(value)
+        {
+            if (!m_value->m_contentLock.tryLockForWrite())
+            {
+                AsyncBlockingDetector::Block block(m_value, api);
+                m_value->m_contentLock.lockForWrite();
+            }
+        }
+
+        ~ContentWriteLocker()
+        {
+            m_value->m_contentLock.unlock();
+        }
+
+    private:
+        AsyncValueBase* m_value;
+    };
+
+    // waits for condition on m_writeLock
+    // should be called under WriteLocker
+    void waitWriteLock(QWaitCondition& condition)
+    {
+        m_writeLockOwner.storeRelease(nullptr);
+        condition.wait(&m_writeLock);
+        m_writeLockOwner.storeRelease(QThread::currentThreadId());
+    }
+
+    // remembers access time if value content can be evicted
+    void touch()
+    {
+        if (m_isEvictable.loadAcquire())
+            m_lastAccess.storeRelease(QDeadlineTimer::current().deadline());
+    }
+
     QMutex m_writeLock;
     QReadWriteLock m_contentLock;
     ASYNC_VALUE_STATE m_state;
@@ -56,6 +218,25 @@ protected:
         QWaitCondition waitSubWaiters;
     };
     Waiter* m_waiter = nullptr;
+
+    // thread that emits stateChanged signal at the moment
+    // (or notifies observers about committed transaction)
+    QAtomicPointer<QThread> m_emitThread;
+    // mutations requested from stateChanged handlers
+    // they are queued under m_writeLock and applied right after the current emit
+    std::deque<std::function<void()>> m_pendingMutations;
+
+    // pool where the value's task is queued but not started yet
+    QAtomicPointer<AsyncThreadPool> m_taskPool;
+    // NUMA node where the value was calculated last time
+    QAtomicInt m_numaNode { -1 };
+    // thread that holds m_writeLock
+    QAtomicPointer<void> m_writeLockOwner;
+    // thread that runs calculation of the value (diagnostics only)
+    QAtomicPointer<void> m_calculationThread;
+    // last access time of the value content (if evictable)
+    QAtomicInt m_isEvictable { 0 };
+    QAtomicInteger<qint64> m_lastAccess { 0 };
 };
 
 #endif // ASYNC_VALUE_BASE_H
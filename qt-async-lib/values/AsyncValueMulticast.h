@@ -0,0 +1,41 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_VALUE_MULTICAST_H
+#define ASYNC_VALUE_MULTICAST_H
+
+#include "AsyncTransaction.h"
+
+// assigns one shared value to all async values at once without copying
+template <typename ValueType, typename... AsyncValueTypes>
+bool asyncValueMulticast(std::shared_ptr<ValueType> value, AsyncValueTypes& ...values)
+{
+    AsyncTransaction transaction;
+
+    using Expander = int[];
+    (void)Expander{ 0, (transaction.shareValue(values, value), 0)... };
+
+    return transaction.commit();
+}
+
+// creates shared value and assigns it to all async values at once
+template <typename ValueType, typename... AsyncValueTypes>
+bool asyncValueMulticast(std::unique_ptr<ValueType> value, AsyncValueTypes& ...values)
+{
+    return asyncValueMulticast(std::shared_ptr<ValueType>(std::move(value)), values...);
+}
+
+#endif // ASYNC_VALUE_MULTICAST_H
@@ -19,6 +19,7 @@
 
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include "AsyncWorkStats.h"
 #include "../third_party/scope_exit.h"
 
 template <typename AsyncValueType, typename Func, typename... ProgressArgs>
@@ -39,6 +40,7 @@ bool asyncValueRunNetwork(QNetworkReply* reply, AsyncValueType& value, Func&& fu
     QObject::connect(reply, &QNetworkReply::finished, [ reply,
                                                         &value,
                                                         progressPtr,
+                                                        group = AsyncWorkStats::group<AsyncValueType>(),
                                                         func = std::forward<Func>(func)](){
         SCOPE_EXIT {
             reply->deleteLater();
@@ -46,7 +48,12 @@ bool asyncValueRunNetwork(QNetworkReply* reply, AsyncValueType& value, Func&& fu
             value.completeProgress(progressPtr);
         };
 
+        // measure post processing only, waiting for the reply takes no work
+        AsyncWorkStats::Run run(group);
+
         func(*reply, value);
+
+        run.finish(AsyncWorkStats::outcome(value, *progressPtr));
     });
 
     return true;
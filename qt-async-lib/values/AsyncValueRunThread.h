@@ -18,6 +18,7 @@
 #define ASYNC_VALUE_RUN_THREAD_H
 
 #include <QThread>
+#include "AsyncWorkStats.h"
 #include "../third_party/scope_exit.h"
 
 template <typename AsyncValueType, typename Func, typename... ProgressArgs>
@@ -29,14 +30,20 @@ bool asyncValueRunThread(AsyncValueType& value, Func&& func, ProgressArgs&& ...p
     if (!value.startProgress(std::move(progress)))
         return false;
 
-    auto thread = QThread::create([&value, progressPtr, func = std::forward<Func>(func)]() {
+    auto thread = QThread::create([&value, progressPtr, group = AsyncWorkStats::group<AsyncValueType>(), func = std::forward<Func>(func)]() {
+        typename AsyncValueType::CalculationThread calculationThread(value);
+
         SCOPE_EXIT {
             // finish progress
             value.completeProgress(progressPtr);
         };
 
+        AsyncWorkStats::Run run(group);
+
         // run calculation
         func(*progressPtr, value);
+
+        run.finish(AsyncWorkStats::outcome(value, *progressPtr));
     });
 
     if (!thread)
@@ -19,6 +19,8 @@
 
 #include <QThreadPool>
 #include <QtConcurrent>
+#include "AsyncThreadPool.h"
+#include "AsyncWorkStats.h"
 #include "../third_party/scope_exit.h"
 
 template <typename AsyncValueType, typename Func, typename... ProgressArgs>
@@ -30,19 +32,101 @@ bool asyncValueRunThreadPool(QThreadPool *pool, AsyncValueType& value, Func&& fu
     if (!value.startProgress(std::move(progress)))
         return false;
 
-    QtConcurrent::run(pool, [&value, progressPtr, func = std::forward<Func>(func)](){
+    QtConcurrent::run(pool, [&value, progressPtr, group = AsyncWorkStats::group<AsyncValueType>(), func = std::forward<Func>(func)](){
+        typename AsyncValueType::CalculationThread calculationThread(value);
+
         SCOPE_EXIT {
             // finish progress
             value.completeProgress(progressPtr);
         };
 
+        AsyncWorkStats::Run run(group);
+
         // run calculation
         func(*progressPtr, value);
+
+        run.finish(AsyncWorkStats::outcome(value, *progressPtr));
     });
 
     return true;
 }
 
+template <typename AsyncValueType, typename Func, typename... ProgressArgs>
+bool asyncValueRunThreadPool(AsyncThreadPool *pool, AsyncTaskOptions options, AsyncValueType& value, Func&& func, ProgressArgs&& ...progressArgs)
+{
+    auto progress = std::make_unique<typename AsyncValueType::ProgressType>(std::forward<ProgressArgs>(progressArgs)...);
+    auto progressPtr = progress.get();
+
+    if (!value.startProgress(std::move(progress)))
+        return false;
+
+    quint64 deadlineId = 0;
+    if (!options.deadline.isForever())
+    {
+        deadlineId = pool->watchDeadline(options.deadline, [progressPtr]() {
+            progressPtr->requestStop();
+        });
+    }
+
+    // task is rejected or dropped from the full queue
+    auto cancel = [&value, progressPtr, pool, deadlineId]() {
+        if (deadlineId)
+            pool->unwatchDeadline(deadlineId);
+
+        value.emplaceError(QString("Task queue overflow"));
+        value.completeProgress(progressPtr);
+    };
+
+    return pool->start([&value, progressPtr, pool, deadlineId, deadline = options.deadline, group = AsyncWorkStats::group<AsyncValueType>(options.category), func = std::forward<Func>(func)](){
+        typename AsyncValueType::CalculationThread calculationThread(value);
+
+        SCOPE_EXIT {
+            // finish progress
+            value.completeProgress(progressPtr);
+        };
+
+        AsyncWorkStats::Run run(group);
+
+        if (!deadlineId)
+        {
+            // run calculation
+            func(*progressPtr, value);
+
+            run.finish(AsyncWorkStats::outcome(value, *progressPtr));
+            return;
+        }
+
+        bool isExpired = false;
+        {
+            SCOPE_EXIT {
+                isExpired = !pool->unwatchDeadline(deadlineId) || deadline.hasExpired();
+            };
+
+            // skip calculation if deadline has expired in the queue
+            if (!deadline.hasExpired())
+                func(*progressPtr, value);
+        }
+
+        // result completed right before the deadline is kept
+        if (isExpired && !value.isValueAssigned())
+            value.emplaceError(QString("Deadline exceeded"));
+
+        run.finish(AsyncWorkStats::outcome(value, *progressPtr));
+    }, &value, options, cancel);
+}
+
+template <typename AsyncValueType, typename Func, typename... ProgressArgs>
+bool asyncValueRunThreadPool(AsyncThreadPool *pool, AsyncValueType& value, Func&& func, ProgressArgs&& ...progressArgs)
+{
+    return asyncValueRunThreadPool(pool, AsyncTaskOptions(), value, std::forward<Func>(func), std::forward<ProgressArgs>(progressArgs)...);
+}
+
+template <typename AsyncValueType, typename Func, typename... ProgressArgs>
+bool asyncValueRunThreadPool(AsyncTaskOptions options, AsyncValueType& value, Func&& func, ProgressArgs&& ...progressArgs)
+{
+    return asyncValueRunThreadPool(AsyncThreadPool::globalInstance(), options, value, std::forward<Func>(func), std::forward<ProgressArgs>(progressArgs)...);
+}
+
 template <typename AsyncValueType, typename Func, typename... ProgressArgs>
 bool asyncValueRunThreadPool(AsyncValueType& value, Func&& func, ProgressArgs&& ...progressArgs)
 {
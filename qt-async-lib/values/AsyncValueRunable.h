@@ -20,23 +20,24 @@
 #include "AsyncValueTemplate.h"
 #include "AsyncError.h"
 #include "AsyncProgress.h"
+#include "AsyncWorkStats.h"
 #include <functional>
 
-template <typename ValueType_t, typename ErrorType_t = AsyncError, typename ProgressType_t = AsyncProgressRerun, typename TrackErrorsPolicy_t = AsyncTrackErrorsPolicyDefault>
-class AsyncValueRunableAbstract : public AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t>
+template <typename ValueType_t, typename ErrorType_t = AsyncError, typename ProgressType_t = AsyncProgressRerun, typename TrackErrorsPolicy_t = AsyncTrackErrorsPolicyDefault, typename ComparePolicy_t = AsyncComparePolicyNone>
+class AsyncValueRunableAbstract : public AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t, ComparePolicy_t>
 {
 public:
     using ValueType = ValueType_t;
     using ErrorType = ErrorType_t;
     using ProgressType = ProgressType_t;
-    using ThisType = AsyncValueRunableAbstract<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t>;
-    using BaseType = AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t>;
+    using ThisType = AsyncValueRunableAbstract<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t, ComparePolicy_t>;
+    using BaseType = AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t, ComparePolicy_t>;
     using RunFnType = std::function<void(ProgressType&, ThisType&)>;
 
     // constructors
     using BaseType::BaseType;
 
-    void run()
+    void run(AsyncTaskOptions options = AsyncTaskOptions())
     {
         bool isInProgress = accessProgress([](ProgressType& progress) {
             // if we are in progress already -> just request rerun
@@ -46,6 +47,8 @@ public:
         if (isInProgress)
             return;
 
+        m_taskOptions = options;
+
         // run later
         deferImpl([this] (ProgressType& progress, ThisType&) {
 
@@ -56,26 +59,35 @@ public:
                 // if no rerun was requested -> we good to exit
                 if (!progress.resetIfRerunRequested())
                     break;
+
+                // account discarded calculation
+                AsyncWorkStats::Run::split(ASYNC_RUN_OUTCOME::SUPERSEDED);
             }
 
         });
     }
 
 protected:
+    // options of the last run to pass to the launcher in deferImpl
+    const AsyncTaskOptions& taskOptions() const { return m_taskOptions; }
+
     virtual void deferImpl(RunFnType&& func) = 0;
     virtual void runImpl(ProgressType& progress) = 0;
+
+private:
+    AsyncTaskOptions m_taskOptions;
 };
 
 
-template <typename ValueType_t, typename ErrorType_t = AsyncError, typename ProgressType_t = AsyncProgressRerun, typename TrackErrorsPolicy_t = AsyncTrackErrorsPolicyDefault>
-class AsyncValueRunableFn : public AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t>
+template <typename ValueType_t, typename ErrorType_t = AsyncError, typename ProgressType_t = AsyncProgressRerun, typename TrackErrorsPolicy_t = AsyncTrackErrorsPolicyDefault, typename ComparePolicy_t = AsyncComparePolicyNone>
+class AsyncValueRunableFn : public AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t, ComparePolicy_t>
 {
 public:
     using ValueType = ValueType_t;
     using ErrorType = ErrorType_t;
     using ProgressType = ProgressType_t;
-    using ThisType = AsyncValueRunableFn<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t>;
-    using BaseType = AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t>;
+    using ThisType = AsyncValueRunableFn<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t, ComparePolicy_t>;
+    using BaseType = AsyncValueTemplate<ValueType_t, ErrorType_t, ProgressType_t, TrackErrorsPolicy_t, ComparePolicy_t>;
     using RunFnType = std::function<void(ProgressType&, ThisType&)>;
     using DeferFnType = std::function<void(const RunFnType&)>;
 
@@ -85,7 +97,10 @@ public:
     DeferFnType deferFn;
     RunFnType runFn;
 
-    void run()
+    // options of the last run to pass to the launcher in deferFn
+    const AsyncTaskOptions& taskOptions() const { return m_taskOptions; }
+
+    void run(AsyncTaskOptions options = AsyncTaskOptions())
     {
         bool isInProgress = accessProgress([](ProgressType& progress) {
             // if we are in progress already -> just request rerun
@@ -95,6 +110,8 @@ public:
         if (isInProgress)
             return;
 
+        m_taskOptions = options;
+
         // run later
         deferFn([this] (ProgressType& progress, ThisType& value) {
 
@@ -105,10 +122,16 @@ public:
                 // if no rerun was requested -> we good to exit
                 if (!progress.resetIfRerunRequested())
                     break;
+
+                // account discarded calculation
+                AsyncWorkStats::Run::split(ASYNC_RUN_OUTCOME::SUPERSEDED);
             }
 
         });
     }
+
+private:
+    AsyncTaskOptions m_taskOptions;
 };
 
 #endif // ASYNC_VALUE_RUNABLE_H
@@ -17,9 +17,13 @@
 #ifndef ASYNC_VALUE_TEMPLATE_H
 #define ASYNC_VALUE_TEMPLATE_H
 
+#include <functional>
 #include <memory>
 #include "AsyncValueBase.h"
 #include "AsyncTrackErrorsPolicy.h"
+#include "AsyncComparePolicy.h"
+#include "AsyncThreadPool.h"
+#include "AsyncEmitProfiler.h"
 
 struct AsyncNoOp
 {
@@ -31,9 +35,11 @@ struct AsyncInitByValue {};
 struct AsyncInitByError {};
 
 
-template <typename ValueType_t, typename ErrorType_t, typename ProgressType_t, typename TrackErrorsPolicy_t = AsyncTrackErrorsPolicyDefault>
+template <typename ValueType_t, typename ErrorType_t, typename ProgressType_t, typename TrackErrorsPolicy_t = AsyncTrackErrorsPolicyDefault, typename ComparePolicy_t = AsyncComparePolicyNone>
 class AsyncValueTemplate : public AsyncValueBase
 {
+    friend class AsyncTransaction;
+
 public:
     using ValueType = ValueType_t;
     using ErrorType = ErrorType_t;
@@ -62,34 +68,189 @@ public:
     template <typename... Args>
     void emplaceValue(Args&& ...arguments)
     {
-        moveValue(std::make_unique<ValueType>(std::forward<Args>(arguments)...));
+        shareValue(std::make_shared<ValueType>(std::forward<Args>(arguments)...));
     }
 
     void moveValue(std::unique_ptr<ValueType> value)
     {
-        m_trackErrors.trackEmitDeadlock();
+        shareValue(std::move(value));
+    }
+
+    // assigns value that can be shared with other async values
+    // shared value should not be modified
+    void shareValue(std::shared_ptr<ValueType> value)
+    {
+        if (isEmittingInCurrentThread())
+        {
+            // called from stateChanged handler -> apply right after the current emit
+            m_pendingMutations.push_back([this, value]() {
+                Content oldContent;
+                moveValueImpl(value, oldContent);
+            });
+            return;
+        }
 
         Content oldContent;
 
-        QMutexLocker writeLocker(&m_writeLock);
+        WriteLocker writeLocker(this, "shareValue");
+        moveValueImpl(std::move(value), oldContent);
+        runPendingMutations();
+    }
+
+    // returns true if error is assigned to the value
+    // unlike accessError it also checks content assigned during progress
+    bool isErrorAssigned()
+    {
+        ReadLocker locker(this, "isErrorAssigned");
+        return m_content.error != nullptr;
+    }
+
+    // returns true if value is assigned to the async value
+    // unlike accessValue it also checks content assigned during progress
+    bool isValueAssigned()
+    {
+        ReadLocker locker(this, "isValueAssigned");
+        return m_content.value != nullptr || m_restoreValue;
+    }
+
+    // returns value that can be shared with other async values
+    // returns nullptr if async value has no value
+    std::shared_ptr<ValueType> sharedValue()
+    {
+        ReadLocker locker(this, "sharedValue");
+        restoreValue(locker);
+
+        if (m_state != ASYNC_VALUE_STATE::VALUE)
+            return nullptr;
+
+        return m_content.value;
+    }
+
+    // if enabled, replaced value is kept to be reused by the next writer
+    void setRecycleValues(bool recycle)
+    {
+        if (isEmittingInCurrentThread())
         {
-            QWriteLocker locker(&m_contentLock);
+            // m_writeLock is locked by this thread already
+            setRecycleValuesImpl(recycle);
+            return;
+        }
 
-            oldContent = std::move(m_content);
-            m_content.value = std::move(value);
+        WriteLocker writeLocker(this, "setRecycleValues");
+        setRecycleValuesImpl(recycle);
+    }
 
-            // don't change state until stopProgress happen
-            if (m_state == ASYNC_VALUE_STATE::PROGRESS)
-                return;
+    // returns replaced value if nobody else references it
+    // writer can fill it and publish using shareValue without new allocation
+    // returns nullptr if there is no such value
+    std::shared_ptr<ValueType> recycleValue()
+    {
+        if (isEmittingInCurrentThread())
+        {
+            // m_writeLock is locked by this thread already
+            return recycleValueImpl();
+        }
+
+        WriteLocker writeLocker(this, "recycleValue");
+        return recycleValueImpl();
+    }
+
+    // enables access tracking required for value eviction
+    // disabling brings evicted value back to memory
+    void setEvictable(bool evictable)
+    {
+        m_lastAccess.storeRelease(QDeadlineTimer::current().deadline());
+        m_isEvictable.storeRelease(evictable ? 1 : 0);
 
-            m_state = ASYNC_VALUE_STATE::VALUE;
+        if (!evictable)
+            restoreValue();
+    }
+
+    // returns true if value content is evicted from memory
+    bool isValueEvicted()
+    {
+        ReadLocker locker(this, "isValueEvicted");
+        return bool(m_restoreValue);
+    }
+
+    // evicts value content if it wasn't accessed for idleMsecs
+    // pack is called outside of the locks and returns function that restores the value
+    // evicted value is restored on the next access
+    // restore returning nullptr turns value to error state with error created by makeError
+    // and notifies observers
+    // returns false if value is not evicted
+    template <typename Pack, typename MakeError>
+    bool evictValue(qint64 idleMsecs, Pack&& pack, MakeError&& makeError)
+    {
+        std::shared_ptr<ValueType> value;
+        qint64 lastAccess = 0;
+
+        {
+            ReadLocker locker(this, "evictValue");
+
+            if (m_state != ASYNC_VALUE_STATE::VALUE || !m_content.value || !m_isEvictable.loadAcquire())
+                return false;
+
+            lastAccess = m_lastAccess.loadAcquire();
+            if (QDeadlineTimer::current().deadline() - lastAccess < idleMsecs)
+                return false;
+
+            value = m_content.value;
         }
 
-        emitStateChanged();
+        // memory cannot be released while value is shared
+        if (value.use_count() > 2)
+            return false;
 
-        // notify all waiters
-        if (m_waiter)
-            m_waiter->waitValue.wakeAll();
+        std::function<std::shared_ptr<ValueType>()> restore = pack(static_cast<const ValueType&>(*value));
+        if (!restore)
+            return false;
+
+        QWriteLocker locker(&m_contentLock);
+
+        // value was accessed or replaced meanwhile
+        if (m_content.value != value || m_lastAccess.loadAcquire() != lastAccess)
+            return false;
+
+        m_content.value = nullptr;
+        m_restoreValue = [restore = std::move(restore), makeError = std::forward<MakeError>(makeError)](Content& content) {
+            content.value = restore();
+            if (!content.value)
+                content.error = makeError();
+        };
+        return true;
+    }
+
+    // modifies value in place and notifies observers once
+    // if value is shared with other async values it's copied before modification
+    // returns false if async value has no value
+    // called from stateChanged handler it's deferred if value is present at the moment of the call
+    // (mutation queued earlier by the handler can still remove the value)
+    template <typename Func>
+    bool modifyValue(Func&& func)
+    {
+        if (isEmittingInCurrentThread())
+        {
+            // m_writeLock is locked by this thread already
+            if (m_state != ASYNC_VALUE_STATE::VALUE)
+                return false;
+
+            // called from stateChanged handler -> apply right after the current emit
+            auto funcHolder = std::make_shared<std::decay_t<Func>>(std::forward<Func>(func));
+            m_pendingMutations.push_back([this, funcHolder]() {
+                std::shared_ptr<ValueType> oldValue;
+                modifyValueImpl(*funcHolder, oldValue);
+            });
+            return true;
+        }
+
+        std::shared_ptr<ValueType> oldValue;
+
+        WriteLocker writeLocker(this, "modifyValue");
+        bool res = modifyValueImpl(func, oldValue);
+        runPendingMutations();
+
+        return res;
     }
 
     template <typename... Args>
@@ -114,29 +275,22 @@ public:
 
     void moveError(std::unique_ptr<ErrorType> error)
     {
-        m_trackErrors.trackEmitDeadlock();
-
-        Content oldContent;
-
-        QMutexLocker writeLocker(&m_writeLock);
+        if (isEmittingInCurrentThread())
         {
-            QWriteLocker locker(&m_contentLock);
-
-            oldContent = std::move(m_content);
-            m_content.error = std::move(error);
-
-            // don't change state until stopProgress happen
-            if (m_state == ASYNC_VALUE_STATE::PROGRESS)
-                return;
-
-            m_state = ASYNC_VALUE_STATE::ERROR;
+            // called from stateChanged handler -> apply right after the current emit
+            auto errorHolder = std::make_shared<std::unique_ptr<ErrorType>>(std::move(error));
+            m_pendingMutations.push_back([this, errorHolder]() {
+                Content oldContent;
+                moveErrorImpl(std::move(*errorHolder), oldContent);
+            });
+            return;
         }
 
-        emitStateChanged();
+        Content oldContent;
 
-        // notify all waiters
-        if (m_waiter)
-            m_waiter->waitValue.wakeAll();
+        WriteLocker writeLocker(this, "moveError");
+        moveErrorImpl(std::move(error), oldContent);
+        runPendingMutations();
     }
 
     bool startProgress(std::unique_ptr<ProgressType> progress)
@@ -147,7 +301,7 @@ public:
 
         Content oldContent;
 
-        QMutexLocker writeLocker(&m_writeLock);
+        WriteLocker writeLocker(this, "startProgress");
 
         if (m_state == ASYNC_VALUE_STATE::PROGRESS)
         {
@@ -159,6 +313,9 @@ public:
             QWriteLocker locker(&m_contentLock);
 
             oldContent = std::move(m_content);
+            m_restoreValue = nullptr;
+            // calculation can reuse the value it replaces
+            retireValue(oldContent);
             m_progress = std::move(progress);
             m_state = ASYNC_VALUE_STATE::PROGRESS;
 
@@ -169,6 +326,7 @@ public:
         }
 
         emitStateChanged();
+        runPendingMutations();
 
         return true;
     }
@@ -181,7 +339,7 @@ public:
         progress->setInUse(false);
 #endif
 
-        QMutexLocker writeLocker(&m_writeLock);
+        WriteLocker writeLocker(this, "completeProgress");
 
         if (progress != m_progress.get())
         {
@@ -211,13 +369,16 @@ public:
         if (m_waiter)
             m_waiter->waitValue.wakeAll();
 
+        runPendingMutations();
+
         return true;
     }
 
     template <typename ValuePred, typename ErrorPred, typename ProgressPred>
     void access(ValuePred valuePred, ErrorPred errorPred, ProgressPred progressPred)
     {
-        QReadLocker locker(&m_contentLock);
+        ReadLocker locker(this, "access");
+        restoreValue(locker);
 
         switch (m_state)
         {
@@ -238,7 +399,8 @@ public:
     template <typename ValuePred, typename ErrorPred>
     bool access(ValuePred valuePred, ErrorPred errorPred)
     {
-        QReadLocker locker(&m_contentLock);
+        ReadLocker locker(this, "access");
+        restoreValue(locker);
 
         switch (m_state)
         {
@@ -258,7 +420,8 @@ public:
     template <typename Pred>
     bool access(Pred valuePred)
     {
-        QReadLocker locker(&m_contentLock);
+        ReadLocker locker(this, "access");
+        restoreValue(locker);
 
         if (m_state != ASYNC_VALUE_STATE::VALUE)
             return false;
@@ -276,7 +439,7 @@ public:
     template <typename Pred>
     bool accessError(Pred errorPred)
     {
-        QReadLocker locker(&m_contentLock);
+        ReadLocker locker(this, "accessError");
 
         if (m_state != ASYNC_VALUE_STATE::ERROR)
             return false;
@@ -288,7 +451,7 @@ public:
     template <typename Pred>
     bool accessProgress(Pred progressPred)
     {
-        QReadLocker locker(&m_contentLock);
+        ReadLocker locker(this, "accessProgress");
 
         if (m_state != ASYNC_VALUE_STATE::PROGRESS)
             return false;
@@ -304,8 +467,24 @@ public:
         if (access(valuePred, errorPred))
             return;
 
-        // lock async value
-        QMutexLocker writeLocker(&m_writeLock);
+        // don't block pool thread if the awaited task is still queued (in any pool)
+        // other tasks are not run here, they could wait for the caller
+        if (AsyncThreadPool::current())
+        {
+            auto pool = m_taskPool.loadAcquire();
+            if (pool && pool->runPendingTask(this) && access(valuePred, errorPred))
+                return;
+        }
+
+        // measure GUI thread waiting for the value
+        AsyncBlockingDetector::Block block(this, "wait");
+        // don't let the awaited task wait behind less important tasks
+        AsyncThreadPool::PriorityInheritance priorityInheritance(this);
+        // let pool start another thread while we are blocked
+        AsyncThreadPool::BlockingRegion blocking;
+
+        // lock async value (blocking is measured above)
+        WriteLocker writeLocker(this, nullptr);
         // check easy case again
         if (access(valuePred, errorPred))
             return;
@@ -321,7 +500,7 @@ public:
                 if (m_waiter->subWaiters > 0)
                 {
                     // wait for all sub waiters
-                    m_waiter->waitSubWaiters.wait(&m_writeLock);
+                    waitWriteLock(m_waiter->waitSubWaiters);
                     Q_ASSERT(m_waiter->subWaiters == 0);
                 }
 
@@ -333,7 +512,7 @@ public:
             m_waiter = &theWaiter;
 
             // wait for value or error
-            m_waiter->waitValue.wait(&m_writeLock);
+            waitWriteLock(m_waiter->waitValue);
             // process
             auto res = access(valuePred, errorPred);
             Q_ASSERT(res && "access should succeeded");
@@ -352,7 +531,7 @@ public:
             m_waiter->subWaiters += 1;
 
             // wait for value or error
-            m_waiter->waitValue.wait(&m_writeLock);
+            waitWriteLock(m_waiter->waitValue);
             // process
             auto res = access(valuePred, errorPred);
             Q_ASSERT(res && "access should succeed");
@@ -378,19 +557,287 @@ private:
         using EmitGuardType = typename TrackErrorsPolicy_t::EmitGuardType;
         EmitGuardType emitGuard(m_trackErrors);
 
+        auto prevEmitThread = m_emitThread.fetchAndStoreOrdered(QThread::currentThread());
+        SCOPE_EXIT {
+            m_emitThread.storeRelease(prevEmitThread);
+        };
+
+        // measures directly connected handlers
+        AsyncEmitProfiler::Emit profile(this, m_state);
+
         emit stateChanged(m_state);
     }
 
     struct Content
     {
-        std::unique_ptr<ValueType> value;
+        std::shared_ptr<ValueType> value;
         std::unique_ptr<ErrorType> error;
     };
     Content m_content;
 
+    // should be called under m_writeLock
+    void moveValueImpl(std::shared_ptr<ValueType> value, Content& oldContent)
+    {
+        {
+            QWriteLocker locker(&m_contentLock);
+
+            if (!assignValue(std::move(value), oldContent))
+                return;
+        }
+
+        notifyStateChanged();
+    }
+
+    // should be called under m_writeLock
+    void moveErrorImpl(std::unique_ptr<ErrorType> error, Content& oldContent)
+    {
+        {
+            QWriteLocker locker(&m_contentLock);
+
+            if (!assignError(std::move(error), oldContent))
+                return;
+        }
+
+        notifyStateChanged();
+    }
+
+    // should be called under m_writeLock
+    template <typename Func>
+    bool modifyValueImpl(Func& func, std::shared_ptr<ValueType>& oldValue)
+    {
+        {
+            QWriteLocker locker(&m_contentLock);
+
+            if (restoreValueImpl())
+            {
+                // value is lost
+                locker.unlock();
+                notifyStateChanged();
+                return false;
+            }
+
+            if (m_state != ASYNC_VALUE_STATE::VALUE)
+                return false;
+
+            // copy on write if value is shared
+            if (m_content.value.use_count() > 1)
+            {
+                oldValue = m_content.value;
+                m_content.value = std::make_shared<ValueType>(*oldValue);
+            }
+
+            func(*m_content.value);
+        }
+
+        notifyStateChanged();
+
+        return true;
+    }
+
+    // should be called under m_writeLock
+    void setRecycleValuesImpl(bool recycle)
+    {
+        m_recycleValues = recycle;
+
+        if (!m_recycleValues)
+            m_retiredValue = nullptr;
+    }
+
+    // should be called under m_writeLock
+    std::shared_ptr<ValueType> recycleValueImpl()
+    {
+        if (!m_retiredValue || m_retiredValue.use_count() > 1)
+            return nullptr;
+
+        return std::move(m_retiredValue);
+    }
+
+    // should be called under m_writeLock
+    // keeps replaced value for recycling and releases previous one outside of the locks
+    void retireValue(Content& oldContent)
+    {
+        if (m_recycleValues && oldContent.value)
+            std::swap(m_retiredValue, oldContent.value);
+    }
+
+    // should be called under m_writeLock and m_contentLock
+    // returns true if observers should be notified
+    bool assignValue(std::shared_ptr<ValueType> value, Content& oldContent)
+    {
+        // skip notification if the new value equals to the current one
+        if (m_state == ASYNC_VALUE_STATE::VALUE && m_content.value && value && m_compare.equal(*m_content.value, *value))
+        {
+            // release the new value outside of the locks
+            oldContent.value = std::move(value);
+            retireValue(oldContent);
+            return false;
+        }
+
+        oldContent = std::move(m_content);
+        m_content.value = std::move(value);
+        m_restoreValue = nullptr;
+        touch();
+        retireValue(oldContent);
+
+        // don't change state until stopProgress happen
+        if (m_state == ASYNC_VALUE_STATE::PROGRESS)
+            return false;
+
+        m_state = ASYNC_VALUE_STATE::VALUE;
+        return true;
+    }
+
+    // should be called under m_writeLock and m_contentLock
+    // returns true if observers should be notified
+    bool assignError(std::unique_ptr<ErrorType> error, Content& oldContent)
+    {
+        oldContent = std::move(m_content);
+        m_content.error = std::move(error);
+        m_restoreValue = nullptr;
+        retireValue(oldContent);
+
+        // don't change state until stopProgress happen
+        if (m_state == ASYNC_VALUE_STATE::PROGRESS)
+            return false;
+
+        m_state = ASYNC_VALUE_STATE::ERROR;
+        return true;
+    }
+
+    // should be called under m_writeLock
+    void notifyStateChanged()
+    {
+        emitStateChanged();
+
+        // notify all waiters
+        if (m_waiter)
+            m_waiter->waitValue.wakeAll();
+    }
+
+    // brings evicted value back to memory
+    // observers are notified if value cannot be restored
+    void restoreValue()
+    {
+        touch();
+
+        if (isWriteLockedInCurrentThread())
+        {
+            // m_writeLock is locked by this thread already
+            restoreValueLocked();
+            return;
+        }
+
+        WriteLocker writeLocker(this, "restoreValue");
+        restoreValueLocked();
+        runPendingMutations();
+    }
+
+    // should be called under m_contentLock locked for read
+    // m_contentLock is relocked for write while evicted value is restored
+    void restoreValue(ReadLocker& locker)
+    {
+        touch();
+
+        while (m_restoreValue)
+        {
+            locker.unlock();
+
+            bool isRestored = false;
+            {
+                ContentWriteLocker writeLocker(this, "restoreValue");
+                isRestored = tryRestoreValueImpl();
+            }
+
+            // value is lost -> change state under m_writeLock
+            if (!isRestored)
+                restoreValue();
+
+            locker.relock();
+        }
+    }
+
+    // should be called under m_contentLock locked for write
+    // returns false if value cannot be restored (it's left evicted then)
+    bool tryRestoreValueImpl()
+    {
+        if (!m_restoreValue)
+            return true;
+
+        Content content;
+        {
+            // decompression or reading of spilled content can block GUI thread
+            AsyncBlockingDetector::Block block(this, "restoreValue");
+            m_restoreValue(content);
+        }
+
+        if (!content.value)
+            return false;
+
+        m_content.value = std::move(content.value);
+        m_restoreValue = nullptr;
+        return true;
+    }
+
+    // should be called under m_writeLock
+    void restoreValueLocked()
+    {
+        {
+            ContentWriteLocker locker(this, "restoreValue");
+
+            if (!restoreValueImpl())
+                return;
+        }
+
+        if (isEmittingInCurrentThread())
+        {
+            // called from stateChanged handler -> notify right after the current emit
+            m_pendingMutations.push_back([this]() {
+                notifyStateChanged();
+            });
+            return;
+        }
+
+        notifyStateChanged();
+    }
+
+    // should be called under m_writeLock and m_contentLock locked for write
+    // value that cannot be restored is replaced by error
+    // returns true if observers should be notified
+    bool restoreValueImpl()
+    {
+        if (!m_restoreValue)
+            return false;
+
+        {
+            AsyncBlockingDetector::Block block(this, "restoreValue");
+            m_restoreValue(m_content);
+        }
+        m_restoreValue = nullptr;
+
+        if (m_content.value)
+            return false;
+
+        Q_ASSERT(m_content.error && "Evicted value should be restored or replaced by error");
+        if (m_state != ASYNC_VALUE_STATE::VALUE)
+            return false;
+
+        m_state = ASYNC_VALUE_STATE::ERROR;
+        return true;
+    }
+
     std::unique_ptr<ProgressType> m_progress;
 
+    // restores evicted value content
+    // guarded by m_contentLock
+    std::function<void(Content&)> m_restoreValue;
+
+    // replaced value kept for recycling
+    // guarded by m_writeLock
+    std::shared_ptr<ValueType> m_retiredValue;
+    bool m_recycleValues = false;
+
     TrackErrorsPolicy_t m_trackErrors;
+    ComparePolicy_t m_compare;
 };
 
 #endif // ASYNC_VALUE_TEMPLATE_H
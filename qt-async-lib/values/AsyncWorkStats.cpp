@@ -0,0 +1,200 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "AsyncWorkStats.h"
+#include <QJsonValue>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <time.h>
+#endif
+
+// run measured in the current thread
+static thread_local AsyncWorkStats::Run* currentRun = nullptr;
+
+// returns CPU time consumed by the current thread in microseconds
+static qint64 threadCpuTime()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0;
+
+    // FILETIME is in 100 nanoseconds
+    auto toUSecs = [](const FILETIME& time) {
+        return static_cast<qint64>((static_cast<quint64>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10;
+    };
+
+    return toUSecs(kernelTime) + toUSecs(userTime);
+#elif defined(Q_OS_UNIX)
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+        return 0;
+
+    return static_cast<qint64>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+#else
+    return 0;
+#endif
+}
+
+static const char* outcomeName(ASYNC_RUN_OUTCOME outcome)
+{
+    switch (outcome)
+    {
+    case ASYNC_RUN_OUTCOME::COMPLETED:
+        return "completed";
+    case ASYNC_RUN_OUTCOME::SUPERSEDED:
+        return "superseded";
+    case ASYNC_RUN_OUTCOME::CANCELLED:
+        return "cancelled";
+    case ASYNC_RUN_OUTCOME::ERRORED:
+        return "errored";
+    }
+
+    return "";
+}
+
+void AsyncWorkStats::record(const QString& group, ASYNC_RUN_OUTCOME outcome, qint64 wallTime, qint64 cpuTime)
+{
+    QMutexLocker locker(&m_lock);
+
+    auto& totals = m_totals[group][static_cast<size_t>(outcome)];
+    ++totals.runs;
+    totals.wallTime += wallTime;
+    totals.cpuTime += cpuTime;
+}
+
+AsyncWorkStats::Totals AsyncWorkStats::totals(const QString& group, ASYNC_RUN_OUTCOME outcome) const
+{
+    QMutexLocker locker(&m_lock);
+
+    auto it = m_totals.find(group);
+    if (it == m_totals.end())
+        return Totals();
+
+    return it.value()[static_cast<size_t>(outcome)];
+}
+
+QStringList AsyncWorkStats::groups() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_totals.keys();
+}
+
+void AsyncWorkStats::reset()
+{
+    QMutexLocker locker(&m_lock);
+    m_totals.clear();
+}
+
+QJsonObject AsyncWorkStats::toJson() const
+{
+    QJsonObject result;
+
+    QMutexLocker locker(&m_lock);
+
+    for (auto it = m_totals.begin(); it != m_totals.end(); ++it)
+    {
+        QJsonObject group;
+
+        for (auto outcome : { ASYNC_RUN_OUTCOME::COMPLETED, ASYNC_RUN_OUTCOME::SUPERSEDED, ASYNC_RUN_OUTCOME::CANCELLED, ASYNC_RUN_OUTCOME::ERRORED })
+        {
+            const auto& totals = it.value()[static_cast<size_t>(outcome)];
+
+            QJsonObject outcomeTotals;
+            outcomeTotals.insert("runs", static_cast<double>(totals.runs));
+            outcomeTotals.insert("wallTime", static_cast<double>(totals.wallTime));
+            outcomeTotals.insert("cpuTime", static_cast<double>(totals.cpuTime));
+
+            group.insert(outcomeName(outcome), outcomeTotals);
+        }
+
+        result.insert(it.key(), group);
+    }
+
+    return result;
+}
+
+AsyncWorkStats::Run::Run(QString group, AsyncWorkStats* stats)
+    : m_stats(stats),
+      m_group(std::move(group)),
+      m_isEnabled(stats->isEnabled()),
+      m_prevRun(currentRun)
+{
+    currentRun = this;
+
+    if (!m_isEnabled)
+        return;
+
+    m_wallTimer.start();
+    m_cpuStart = threadCpuTime();
+}
+
+AsyncWorkStats::Run::~Run()
+{
+    if (!m_isFinished)
+        finish(ASYNC_RUN_OUTCOME::ERRORED);
+
+    // exclude this run from the outer one
+    if (m_prevRun && m_isEnabled)
+    {
+        m_prevRun->m_nestedWallTime += m_totalWallTime;
+        m_prevRun->m_nestedCpuTime += m_totalCpuTime;
+    }
+
+    currentRun = m_prevRun;
+}
+
+void AsyncWorkStats::Run::finish(ASYNC_RUN_OUTCOME outcome)
+{
+    Q_ASSERT(!m_isFinished);
+    m_isFinished = true;
+
+    record(outcome);
+}
+
+void AsyncWorkStats::Run::split(ASYNC_RUN_OUTCOME outcome)
+{
+    auto run = currentRun;
+    if (!run || run->m_isFinished)
+        return;
+
+    run->record(outcome);
+
+    if (!run->m_isEnabled)
+        return;
+
+    run->m_wallTimer.restart();
+    run->m_cpuStart = threadCpuTime();
+}
+
+void AsyncWorkStats::Run::record(ASYNC_RUN_OUTCOME outcome)
+{
+    if (!m_isEnabled)
+        return;
+
+    auto wallTime = m_wallTimer.nsecsElapsed() / 1000;
+    auto cpuTime = threadCpuTime() - m_cpuStart;
+
+    m_totalWallTime += wallTime;
+    m_totalCpuTime += cpuTime;
+
+    m_stats->record(m_group, outcome, qMax<qint64>(0, wallTime - m_nestedWallTime), qMax<qint64>(0, cpuTime - m_nestedCpuTime));
+
+    m_nestedWallTime = 0;
+    m_nestedCpuTime = 0;
+}
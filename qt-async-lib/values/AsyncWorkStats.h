@@ -0,0 +1,128 @@
+/*
+   Copyright (c) 2018 Alex Zhondin <lexxmark.dev@gmail.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef ASYNC_WORK_STATS_H
+#define ASYNC_WORK_STATS_H
+
+#include "AsyncProfiler.h"
+#include <QMutex>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <array>
+#include <typeinfo>
+
+enum class ASYNC_RUN_OUTCOME
+{
+    // calculation has assigned value
+    COMPLETED,
+    // calculation was discarded by rerun
+    SUPERSEDED,
+    // calculation was stopped
+    CANCELLED,
+    // calculation has assigned error or has thrown exception
+    ERRORED
+};
+
+// collects wall and CPU time of calculations by groups (value types or task categories) and outcomes
+// NOTE: statistics are collected only if enabled
+class AsyncWorkStats : public AsyncProfiler<AsyncWorkStats>
+{
+    Q_DISABLE_COPY(AsyncWorkStats)
+
+public:
+    // times are in microseconds
+    struct Totals
+    {
+        quint64 runs = 0;
+        qint64 wallTime = 0;
+        qint64 cpuTime = 0;
+    };
+
+    AsyncWorkStats() = default;
+
+    void record(const QString& group, ASYNC_RUN_OUTCOME outcome, qint64 wallTime, qint64 cpuTime);
+    Totals totals(const QString& group, ASYNC_RUN_OUTCOME outcome) const;
+    QStringList groups() const;
+    void reset();
+
+    // returns {"group": {"completed": {"runs": 1, "wallTime": 10, "cpuTime": 8}, ...}, ...}
+    QJsonObject toJson() const;
+
+    // returns group name for the async value type or the task category
+    template <typename AsyncValueType>
+    static QString group(const QString& category = QString())
+    {
+        if (!category.isEmpty())
+            return category;
+
+        return asyncTypeName(typeid(typename AsyncValueType::ValueType));
+    }
+
+    // returns outcome of the calculation that is about to complete progress
+    template <typename AsyncValueType, typename ProgressType>
+    static ASYNC_RUN_OUTCOME outcome(AsyncValueType& value, const ProgressType& progress)
+    {
+        if (!value.isErrorAssigned())
+            return ASYNC_RUN_OUTCOME::COMPLETED;
+
+        return progress.isStopRequested() ? ASYNC_RUN_OUTCOME::CANCELLED : ASYNC_RUN_OUTCOME::ERRORED;
+    }
+
+    // measures calculation run in the current thread
+    // run not finished explicitly is recorded as errored
+    // time of nested runs is excluded from the outer run
+    class Run
+    {
+        Q_DISABLE_COPY(Run)
+
+    public:
+        explicit Run(QString group, AsyncWorkStats* stats = globalInstance());
+        ~Run();
+
+        // records the run since start or the last split
+        void finish(ASYNC_RUN_OUTCOME outcome);
+
+        // records part of the run in the current thread and starts measuring the rest
+        // runnable values call it when rerun discards calculation
+        static void split(ASYNC_RUN_OUTCOME outcome);
+
+    private:
+        void record(ASYNC_RUN_OUTCOME outcome);
+
+        AsyncWorkStats* m_stats;
+        QString m_group;
+        bool m_isEnabled;
+        bool m_isFinished = false;
+        QElapsedTimer m_wallTimer;
+        qint64 m_cpuStart = 0;
+        // whole time of the run including nested runs
+        qint64 m_totalWallTime = 0;
+        qint64 m_totalCpuTime = 0;
+        // time of nested runs since start or the last split
+        qint64 m_nestedWallTime = 0;
+        qint64 m_nestedCpuTime = 0;
+        Run* m_prevRun;
+    };
+
+private:
+    mutable QMutex m_lock;
+    QHash<QString, std::array<Totals, 4>> m_totals;
+};
+
+#endif // ASYNC_WORK_STATS_H
@@ -5,6 +5,17 @@
 #include "values/AsyncValueRunThreadPool.h"
 #include "values/AsyncValueRunNetwork.h"
 #include "values/AsyncValueRunable.h"
+#include "values/AsyncTransaction.h"
+#include "values/AsyncValueMulticast.h"
+#include "values/AsyncProjection.h"
+#include "values/AsyncTaskScope.h"
+#include "values/AsyncNumaPools.h"
+#include "values/AsyncPrefetchCache.h"
+#include "values/AsyncStartupLoader.h"
+#include "values/AsyncColdStorage.h"
+#include "values/AsyncEmitProfiler.h"
+#include "values/AsyncBlockingDetector.h"
+#include <atomic>
 
 void TestAsyncValue::simple()
 {
@@ -78,7 +89,7 @@ void TestAsyncValue::catchDeadlock()
     AsyncValue<int> value(AsyncInitByValue(), 8);
 
     QObject::connect(&value, &AsyncValue<int>::stateChanged, [&value](ASYNC_VALUE_STATE){
-        value.emplaceValue(3);
+        value.startProgress(std::make_unique<AsyncProgress>("", ASYNC_CAN_REQUEST_STOP::NO));
     });
 
     bool deadlock = false;
@@ -95,6 +106,34 @@ void TestAsyncValue::catchDeadlock()
     QVERIFY(deadlock);
 }
 
+void TestAsyncValue::deferredMutation()
+{
+    AsyncValue<int> value(AsyncInitByValue(), 8);
+
+    std::vector<int> values;
+
+    QObject::connect(&value, &AsyncValue<int>::stateChanged, [&value, &values](ASYNC_VALUE_STATE){
+        value.accessValue([&values](int val){
+            values.push_back(val);
+        });
+
+        // cascaded updates
+        value.accessValue([&value](int val){
+            if (val < 10)
+                value.emplaceValue(val + 1);
+        });
+    });
+
+    value.emplaceValue(7);
+
+    // all cascaded updates are applied synchronously and in order
+    QCOMPARE(values, std::vector<int>({7, 8, 9, 10}));
+
+    value.accessValue([](int val){
+        QCOMPARE(val, 10);
+    });
+}
+
 void TestAsyncValue::wait()
 {
     AsyncValue<int> value(AsyncInitByValue(), 8);
@@ -192,3 +231,1270 @@ void TestAsyncValue::network()
         QCOMPARE(value, 671);
     });
 }
+
+void TestAsyncValue::transaction()
+{
+    AsyncValue<int> series(AsyncInitByValue(), 1);
+    AsyncValue<QString> axis(AsyncInitByValue(), "1");
+
+    int seriesChanged = 0;
+    QObject::connect(&series, &AsyncValueBase::stateChanged, [&](ASYNC_VALUE_STATE){
+        ++seriesChanged;
+
+        // observer sees both values already published
+        auto res = AsyncTransaction::accessValues([](int series, const QString& axis){
+            QCOMPARE(series, 2);
+            QCOMPARE(axis, QString("2"));
+        }, series, axis);
+        QVERIFY(res);
+    });
+
+    AsyncTransaction transaction;
+
+    int committed = 0;
+    QObject::connect(&transaction, &AsyncTransaction::committed, [&committed](){
+        ++committed;
+    });
+
+    transaction.emplaceValue(series, 2);
+    transaction.emplaceValue(axis, "2");
+
+    // nothing is published before commit
+    series.accessValue([](int series){
+        QCOMPARE(series, 1);
+    });
+
+    QVERIFY(transaction.commit());
+    QCOMPARE(seriesChanged, 1);
+    QCOMPARE(committed, 1);
+
+    axis.accessValue([](const QString& axis){
+        QCOMPARE(axis, QString("2"));
+    });
+}
+
+void TestAsyncValue::multicast()
+{
+    AsyncValue<std::vector<int>> value1(AsyncInitByError(), "no value");
+    AsyncValue<std::vector<int>> value2(AsyncInitByError(), "no value");
+
+    asyncValueRunThreadPool(value1, [&value2](AsyncProgress&, AsyncValue<std::vector<int>>& value1) {
+        auto result = std::make_shared<std::vector<int>>(1000, 42);
+        asyncValueMulticast(result, value1, value2);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    value1.wait();
+
+    auto shared1 = value1.sharedValue();
+    auto shared2 = value2.sharedValue();
+
+    QVERIFY(shared1);
+    // both values reference the same content
+    QCOMPARE(shared1, shared2);
+    QCOMPARE(shared1->size(), size_t(1000));
+}
+
+void TestAsyncValue::projection()
+{
+    struct Report
+    {
+        int count;
+        QString name;
+    };
+
+    AsyncValue<Report> value(AsyncInitByValue(), Report{1, "first"});
+
+    auto count = asyncProjection(value, &Report::count);
+    auto name = asyncProjection(value, [](Report& report) { return report.name; });
+
+    int countChanged = 0;
+    QObject::connect(count.get(), &AsyncValueBase::stateChanged, [&countChanged](ASYNC_VALUE_STATE){
+        ++countChanged;
+    });
+
+    int nameChanged = 0;
+    QObject::connect(name.get(), &AsyncValueBase::stateChanged, [&nameChanged](ASYNC_VALUE_STATE){
+        ++nameChanged;
+    });
+
+    // count is not changed
+    value.emplaceValue(Report{1, "second"});
+    QCOMPARE(countChanged, 0);
+    QCOMPARE(nameChanged, 1);
+
+    // count is changed
+    value.emplaceValue(Report{2, "second"});
+    QCOMPARE(countChanged, 1);
+    QCOMPARE(nameChanged, 1);
+
+    auto res = count->accessValue([](int count){
+        QCOMPARE(count, 2);
+    });
+    QVERIFY(res);
+
+    // recalculation with the same count is not noticed
+    auto progress = std::make_unique<AsyncProgress>("", ASYNC_CAN_REQUEST_STOP::NO);
+    auto progressPtr = progress.get();
+    value.startProgress(std::move(progress));
+
+    // projection keeps its value while parent is recalculated
+    res = count->accessValue([](int count){
+        QCOMPARE(count, 2);
+    });
+    QVERIFY(res);
+
+    value.emplaceValue(Report{2, "third"});
+    value.completeProgress(progressPtr);
+    QCOMPARE(countChanged, 1);
+    QCOMPARE(nameChanged, 2);
+
+    // errors are always propagated
+    value.emplaceError("no report");
+    QCOMPARE(countChanged, 2);
+    QVERIFY(count->accessError(AsyncNoOp()));
+}
+
+void TestAsyncValue::skipEqualValues()
+{
+    AsyncValueTemplate<QString, AsyncError, AsyncProgress, AsyncTrackErrorsPolicyDefault, AsyncComparePolicyEqual> value(AsyncInitByValue(), "data");
+
+    int changed = 0;
+    QObject::connect(&value, &AsyncValueBase::stateChanged, [&changed](ASYNC_VALUE_STATE){
+        ++changed;
+    });
+
+    value.emplaceValue("data");
+    QCOMPARE(changed, 0);
+
+    value.emplaceValue("new data");
+    QCOMPARE(changed, 1);
+
+    value.emplaceError("error");
+    value.emplaceValue("new data");
+    QCOMPARE(changed, 3);
+}
+
+void TestAsyncValue::modifyValue()
+{
+    AsyncValue<std::vector<int>> value(AsyncInitByValue(), 1000, 0);
+
+    int changed = 0;
+    QObject::connect(&value, &AsyncValueBase::stateChanged, [&changed](ASYNC_VALUE_STATE){
+        ++changed;
+    });
+
+    auto content = value.sharedValue();
+
+    auto res = value.modifyValue([](std::vector<int>& value){
+        value[10] = 42;
+    });
+    QVERIFY(res);
+    QCOMPARE(changed, 1);
+
+    // shared content is not modified
+    QCOMPARE((*content)[10], 0);
+    QVERIFY(content != value.sharedValue());
+
+    content.reset();
+    auto data = value.sharedValue()->data();
+
+    // not shared content is modified in place
+    value.modifyValue([](std::vector<int>& value){
+        value[11] = 43;
+    });
+    QCOMPARE(changed, 2);
+    QCOMPARE(value.sharedValue()->data(), data);
+
+    value.accessValue([](const std::vector<int>& value){
+        QCOMPARE(value[10], 42);
+        QCOMPARE(value[11], 43);
+    });
+
+    // no value -> no modifications
+    value.emplaceError("no value");
+    QVERIFY(!value.modifyValue(AsyncNoOp()));
+
+    // same for modifications deferred from handlers
+    bool deferredRes = true;
+    int handled = 0;
+    auto connection = QObject::connect(&value, &AsyncValueBase::stateChanged, [&value, &deferredRes, &handled](ASYNC_VALUE_STATE){
+        if (++handled == 1)
+            deferredRes = value.modifyValue(AsyncNoOp());
+    });
+    value.emplaceError("still no value");
+    QVERIFY(!deferredRes);
+
+    // deferred modification notifies observers after the current emit
+    handled = 0;
+    value.emplaceValue(1000, 0);
+    QVERIFY(deferredRes);
+    QCOMPARE(handled, 2);
+    QObject::disconnect(connection);
+}
+
+void TestAsyncValue::recycleValues()
+{
+    AsyncValue<std::vector<int>> value(AsyncInitByValue(), 1000, 0);
+    value.setRecycleValues(true);
+
+    // nothing to recycle yet
+    QVERIFY(!value.recycleValue());
+
+    auto initialData = value.sharedValue()->data();
+    value.emplaceValue(1000, 1);
+
+    // replaced value is reused
+    auto buffer = value.recycleValue();
+    QVERIFY(buffer);
+    QCOMPARE(buffer->data(), initialData);
+
+    std::fill(buffer->begin(), buffer->end(), 2);
+    value.shareValue(std::move(buffer));
+
+    value.accessValue([initialData](const std::vector<int>& value){
+        QCOMPARE(value.data(), initialData);
+        QCOMPARE(value[0], 2);
+    });
+
+    // replaced value is referenced by reader -> cannot be recycled
+    auto snapshot = value.sharedValue();
+    value.emplaceValue(1000, 3);
+    QVERIFY(!value.recycleValue());
+    snapshot.reset();
+
+    // calculation reuses the value replaced by progress
+    auto calculatedData = value.sharedValue()->data();
+    bool isRecycled = false;
+    asyncValueRunThreadPool(value, [&isRecycled](AsyncProgress&, AsyncValue<std::vector<int>>& value) {
+        auto buffer = value.recycleValue();
+        isRecycled = bool(buffer);
+        if (!buffer)
+            buffer = std::make_shared<std::vector<int>>(1000);
+
+        std::fill(buffer->begin(), buffer->end(), 4);
+        value.shareValue(std::move(buffer));
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    value.wait();
+
+    QVERIFY(isRecycled);
+    QCOMPARE(value.sharedValue()->data(), calculatedData);
+}
+
+void TestAsyncValue::taskScope()
+{
+    AsyncValue<int> parent(AsyncInitByValue(), 0);
+    AsyncValue<int> child1(AsyncInitByValue(), 0);
+    AsyncValue<int> child2(AsyncInitByValue(), 0);
+
+    // parent blocks the only thread while waiting for children
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    asyncValueRunThreadPool(&pool, parent, [&](AsyncProgress& progress, AsyncValue<int>& parent) {
+        int sum = 0;
+
+        {
+            AsyncTaskScope scope(progress, &pool);
+
+            auto childFn = [](AsyncProgress&, AsyncValue<int>& child) {
+                QThread::msleep(200);
+                child.emplaceValue(21);
+            };
+
+            QVERIFY(scope.run(child1, childFn, "", ASYNC_CAN_REQUEST_STOP::YES));
+            QVERIFY(scope.run(child2, childFn, "", ASYNC_CAN_REQUEST_STOP::YES));
+
+            // wait for children
+            scope.wait();
+
+            child1.accessValue([&sum](int val) { sum += val; });
+            child2.accessValue([&sum](int val) { sum += val; });
+        }
+
+        parent.emplaceValue(sum);
+    }, "", ASYNC_CAN_REQUEST_STOP::YES);
+
+    parent.wait([](int val){
+        QCOMPARE(val, 42);
+    }, AsyncNoOp());
+
+    // stop parent -> stop children
+    QSemaphore isChildStarted;
+
+    asyncValueRunThreadPool(&pool, parent, [&](AsyncProgress& progress, AsyncValue<int>& parent) {
+        AsyncTaskScope scope(progress, &pool);
+
+        scope.run(child1, [](AsyncProgress& progress, AsyncValue<int>& child) {
+            while (!progress.isStopRequested())
+                QThread::msleep(10);
+
+            child.emplaceError("Stopped");
+        }, "", ASYNC_CAN_REQUEST_STOP::YES);
+
+        isChildStarted.release();
+
+        scope.wait();
+        parent.emplaceError("Stopped");
+    }, "", ASYNC_CAN_REQUEST_STOP::YES);
+
+    isChildStarted.acquire();
+    parent.stopAndWait();
+
+    QVERIFY(parent.accessError(AsyncNoOp()));
+    child1.wait();
+    QVERIFY(child1.accessError(AsyncNoOp()));
+}
+
+void TestAsyncValue::helpWhileWaiting()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    AsyncValue<int> value1(AsyncInitByValue(), 0);
+    AsyncValue<int> value2(AsyncInitByValue(), 0);
+
+    QSemaphore isValue2Started;
+
+    asyncValueRunThreadPool(&pool, value1, [&](AsyncProgress&, AsyncValue<int>& value1) {
+        // wait for value2 that is queued after us
+        isValue2Started.acquire();
+
+        int res = 0;
+        value2.wait([&res](int val){
+            res = val;
+        }, AsyncNoOp());
+
+        value1.emplaceValue(res * 2);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    asyncValueRunThreadPool(&pool, value2, [](AsyncProgress&, AsyncValue<int>& value2) {
+        value2.emplaceValue(21);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    isValue2Started.release();
+
+    value1.wait([](int val){
+        QCOMPARE(val, 42);
+    }, AsyncNoOp());
+
+    // awaited task queued in another busy pool is run inline too
+    QThreadPool otherThreadPool;
+    otherThreadPool.setMaxThreadCount(1);
+    AsyncThreadPool otherPool(&otherThreadPool);
+
+    QSemaphore gate;
+    AsyncValue<int> gateValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&otherPool, gateValue, [&gate](AsyncProgress&, AsyncValue<int>& value) {
+        gate.acquire();
+        value.emplaceValue(0);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    AsyncValue<int> value3(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&otherPool, value3, [](AsyncProgress&, AsyncValue<int>& value3) {
+        value3.emplaceValue(3);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    AsyncValue<int> value4(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, value4, [&value3](AsyncProgress&, AsyncValue<int>& value4) {
+        int res = 0;
+        value3.wait([&res](int val){
+            res = val;
+        }, AsyncNoOp());
+
+        value4.emplaceValue(res);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    value4.wait([](int val){
+        QCOMPARE(val, 3);
+    }, AsyncNoOp());
+
+    gate.release();
+    gateValue.wait();
+}
+
+void TestAsyncValue::priorityInheritance()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    QMutex lock;
+    std::vector<int> order;
+
+    auto taskFn = [&lock, &order](int id) {
+        return [&lock, &order, id](AsyncProgress&, AsyncValue<int>& value) {
+            {
+                QMutexLocker locker(&lock);
+                order.push_back(id);
+            }
+            value.emplaceValue(id);
+        };
+    };
+
+    // block the only pool thread
+    QSemaphore gate;
+    AsyncValue<int> gateValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, gateValue, [&gate](AsyncProgress&, AsyncValue<int>& value) {
+        gate.acquire();
+        value.emplaceValue(0);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    AsyncTaskOptions lowPriority;
+    lowPriority.priority = -1;
+
+    AsyncValue<int> value1(AsyncInitByValue(), 0);
+    AsyncValue<int> value2(AsyncInitByValue(), 0);
+    AsyncValue<int> awaited(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, lowPriority, value1, taskFn(1), "", ASYNC_CAN_REQUEST_STOP::NO);
+    asyncValueRunThreadPool(&pool, lowPriority, value2, taskFn(2), "", ASYNC_CAN_REQUEST_STOP::NO);
+    asyncValueRunThreadPool(&pool, lowPriority, awaited, taskFn(3), "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    // open gate after this thread starts waiting
+    QThreadPool otherPool;
+    QtConcurrent::run(&otherPool, [&gate]() {
+        QThread::msleep(200);
+        gate.release();
+    });
+
+    // awaited task is moved in front of the queue
+    awaited.wait();
+
+    value1.wait();
+    value2.wait();
+    gateValue.wait();
+
+    QCOMPARE(order.front(), 3);
+}
+
+void TestAsyncValue::deadline()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    // stop is requested when deadline expires
+    {
+        AsyncTaskOptions options;
+        options.deadline = QDeadlineTimer(100);
+
+        AsyncValue<int> value(AsyncInitByValue(), 0);
+        asyncValueRunThreadPool(&pool, options, value, [](AsyncProgress& progress, AsyncValue<int>&) {
+            // stopped calculation doesn't assign value
+            while (!progress.isStopRequested())
+                QThread::msleep(10);
+        }, "", ASYNC_CAN_REQUEST_STOP::YES);
+
+        value.wait();
+        QVERIFY(value.accessError([](const AsyncError&) {}));
+    }
+
+    // value completed despite expired deadline is kept
+    {
+        AsyncTaskOptions options;
+        options.deadline = QDeadlineTimer(50);
+
+        AsyncValue<int> value(AsyncInitByValue(), 0);
+        asyncValueRunThreadPool(&pool, options, value, [](AsyncProgress&, AsyncValue<int>& value) {
+            QThread::msleep(100);
+            value.emplaceValue(2);
+        }, "", ASYNC_CAN_REQUEST_STOP::YES);
+
+        value.wait();
+        QVERIFY(value.accessValue([](int value) {
+            QCOMPARE(value, 2);
+        }));
+    }
+
+    // tasks are run in the earliest deadline first order
+    {
+        QMutex lock;
+        std::vector<int> order;
+
+        auto taskFn = [&lock, &order](int id) {
+            return [&lock, &order, id](AsyncProgress&, AsyncValue<int>& value) {
+                {
+                    QMutexLocker locker(&lock);
+                    order.push_back(id);
+                }
+                value.emplaceValue(id);
+            };
+        };
+
+        // block the only pool thread
+        QSemaphore gate;
+        AsyncValue<int> gateValue(AsyncInitByValue(), 0);
+        asyncValueRunThreadPool(&pool, gateValue, [&gate](AsyncProgress&, AsyncValue<int>& value) {
+            gate.acquire();
+            value.emplaceValue(0);
+        }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+        AsyncTaskOptions lateOptions;
+        lateOptions.deadline = QDeadlineTimer(20000);
+        AsyncTaskOptions earlyOptions;
+        earlyOptions.deadline = QDeadlineTimer(10000);
+
+        AsyncValue<int> value1(AsyncInitByValue(), 0);
+        AsyncValue<int> value2(AsyncInitByValue(), 0);
+        AsyncValue<int> value3(AsyncInitByValue(), 0);
+        asyncValueRunThreadPool(&pool, value1, taskFn(1), "", ASYNC_CAN_REQUEST_STOP::NO);
+        asyncValueRunThreadPool(&pool, lateOptions, value2, taskFn(2), "", ASYNC_CAN_REQUEST_STOP::NO);
+        asyncValueRunThreadPool(&pool, earlyOptions, value3, taskFn(3), "", ASYNC_CAN_REQUEST_STOP::NO);
+
+        gate.release();
+
+        gateValue.wait();
+        value1.wait();
+        value2.wait();
+        value3.wait();
+
+        QCOMPARE(order, (std::vector<int>{3, 2, 1}));
+    }
+}
+
+void TestAsyncValue::categoryLimit()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    AsyncThreadPool pool(&threadPool);
+
+    pool.setCategoryLimit("decode", 1);
+    QCOMPARE(pool.categoryLimit("decode"), 1);
+
+    AsyncTaskOptions decodeOptions;
+    decodeOptions.category = "decode";
+
+    QSemaphore gate;
+    std::atomic<int> running(0);
+    std::atomic<int> maxRunning(0);
+
+    std::vector<std::unique_ptr<AsyncValue<int>>> decodes;
+    for (int i = 0; i < 4; ++i)
+    {
+        decodes.push_back(std::make_unique<AsyncValue<int>>(AsyncInitByValue(), 0));
+        asyncValueRunThreadPool(&pool, decodeOptions, *decodes.back(), [&](AsyncProgress&, AsyncValue<int>& value) {
+            auto count = ++running;
+            auto prevMax = maxRunning.load();
+            while (prevMax < count && !maxRunning.compare_exchange_weak(prevMax, count)) {}
+
+            gate.acquire();
+            --running;
+            value.emplaceValue(1);
+        }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    }
+
+    // tasks of other categories are not blocked by decodes
+    AsyncValue<int> other(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, other, [](AsyncProgress&, AsyncValue<int>& value) {
+        value.emplaceValue(2);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    other.wait();
+
+    gate.release(4);
+    for (auto& decode : decodes)
+        decode->wait();
+
+    QCOMPARE(maxRunning.load(), 1);
+}
+
+void TestAsyncValue::boundedQueue()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    // block the only pool thread
+    QSemaphore gateStarted;
+    QSemaphore gate;
+    AsyncValue<int> gateValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, gateValue, [&gateStarted, &gate](AsyncProgress&, AsyncValue<int>& value) {
+        gateStarted.release();
+        gate.acquire();
+        value.emplaceValue(0);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    gateStarted.acquire();
+
+    auto taskFn = [](AsyncProgress&, AsyncValue<int>& value) {
+        value.emplaceValue(1);
+    };
+
+    auto isError = [](AsyncValue<int>& value) {
+        return value.accessError([](const AsyncError&) {});
+    };
+
+    pool.setQueueLimit(QString(), 2, ASYNC_QUEUE_OVERFLOW::REJECT);
+
+    AsyncValue<int> value1(AsyncInitByValue(), 0);
+    AsyncValue<int> value2(AsyncInitByValue(), 0);
+    AsyncValue<int> value3(AsyncInitByValue(), 0);
+    QVERIFY(asyncValueRunThreadPool(&pool, value1, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO));
+    QVERIFY(asyncValueRunThreadPool(&pool, value2, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO));
+    // queue is full
+    QVERIFY(!asyncValueRunThreadPool(&pool, value3, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO));
+    QVERIFY(isError(value3));
+    QCOMPARE(pool.queueSize(), 2);
+
+    pool.setQueueLimit(QString(), 2, ASYNC_QUEUE_OVERFLOW::DROP_OLDEST);
+
+    // value1 is dropped
+    QVERIFY(asyncValueRunThreadPool(&pool, value3, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO));
+    QVERIFY(isError(value1));
+    QCOMPARE(pool.queueSize(), 2);
+
+    pool.setQueueLimit(QString(), 2, ASYNC_QUEUE_OVERFLOW::BLOCK, 100);
+
+    // blocking times out
+    AsyncValue<int> value4(AsyncInitByValue(), 0);
+    QVERIFY(!asyncValueRunThreadPool(&pool, value4, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO));
+    QVERIFY(isError(value4));
+
+    gate.release();
+
+    gateValue.wait();
+    value2.wait();
+    value3.wait();
+    QVERIFY(!isError(value2));
+    QVERIFY(!isError(value3));
+}
+
+void TestAsyncValue::blockingWorkers()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    // blocking tasks are run in the blocking pool
+    AsyncTaskOptions blockingOptions;
+    blockingOptions.blocking = true;
+
+    AsyncThreadPool* taskPool = nullptr;
+    AsyncValue<int> blockingValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, blockingOptions, blockingValue, [&taskPool](AsyncProgress&, AsyncValue<int>& value) {
+        taskPool = AsyncThreadPool::current();
+        value.emplaceValue(1);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    blockingValue.wait();
+    QCOMPARE(taskPool, pool.blockingPool());
+
+    // worker blocked too long is compensated by another thread
+    QSemaphore isReleased;
+
+    AsyncValue<int> blocked(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, blocked, [&isReleased](AsyncProgress&, AsyncValue<int>& value) {
+        AsyncThreadPool::BlockingRegion blocking;
+        isReleased.acquire();
+        value.emplaceValue(1);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    AsyncValue<int> releaser(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, releaser, [&isReleased](AsyncProgress&, AsyncValue<int>& value) {
+        isReleased.release();
+        value.emplaceValue(2);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+    blocked.wait();
+    releaser.wait();
+}
+
+void TestAsyncValue::adaptiveExecution()
+{
+    QThreadPool threadPool;
+    AsyncThreadPool pool(&threadPool);
+
+    AsyncTaskOptions options;
+    options.key = "tiny";
+
+    QThread* taskThread = nullptr;
+    auto taskFn = [&taskThread](AsyncProgress&, AsyncValue<int>& value) {
+        taskThread = QThread::currentThread();
+        value.emplaceValue(1);
+    };
+
+    QCOMPARE(pool.expectedDuration("tiny"), -1);
+
+    // first run goes to the pool
+    AsyncValue<int> value(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, options, value, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO);
+    value.wait();
+    threadPool.waitForDone();
+
+    QVERIFY(pool.expectedDuration("tiny") >= 0);
+    QVERIFY(taskThread != QThread::currentThread());
+
+    // don't depend on the measured duration
+    pool.setExpectedDuration("tiny", 0);
+
+    // tiny task started from a pool thread is run inline
+    QThread* outerThread = nullptr;
+    AsyncValue<int> outerValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, outerValue, [&pool, &options, &value, &taskFn, &outerThread](AsyncProgress&, AsyncValue<int>& outerValue) {
+        outerThread = QThread::currentThread();
+        asyncValueRunThreadPool(&pool, options, value, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO);
+        outerValue.emplaceValue(value.accessValue([](int) {}) ? 1 : 0);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    outerValue.wait();
+    QCOMPARE(taskThread, outerThread);
+    QVERIFY(outerValue.accessValue([](int value) {
+        QCOMPARE(value, 1);
+    }));
+
+    // tiny task started from the GUI thread goes to the pool
+    // so GUI thread receivers get stateChanged through the event loop
+    // and can restart the value
+    QObject context;
+    int restarts = 0;
+    auto connection = QObject::connect(&value, &AsyncValueBase::stateChanged, &context, [&](ASYNC_VALUE_STATE state){
+        if (state == ASYNC_VALUE_STATE::VALUE && ++restarts == 1)
+            asyncValueRunThreadPool(&pool, options, value, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO);
+    });
+    asyncValueRunThreadPool(&pool, options, value, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO);
+    QCOMPARE(restarts, 0);
+    QTRY_COMPARE(restarts, 2);
+    QVERIFY(taskThread != QThread::currentThread());
+    QVERIFY(!AsyncThreadPool::current());
+    QObject::disconnect(connection);
+    threadPool.waitForDone();
+
+    // tiny task respects the category limit
+    AsyncTaskOptions gateOptions;
+    gateOptions.category = "limited";
+    options.category = "limited";
+    pool.setCategoryLimit("limited", 1);
+
+    QSemaphore gateStarted;
+    QSemaphore gate;
+    AsyncValue<int> gateValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, gateOptions, gateValue, [&gateStarted, &gate](AsyncProgress&, AsyncValue<int>& value) {
+        gateStarted.release();
+        gate.acquire();
+        value.emplaceValue(1);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    gateStarted.acquire();
+
+    AsyncValue<int> launchValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, launchValue, [&pool, &options, &value, &taskFn](AsyncProgress&, AsyncValue<int>& launchValue) {
+        asyncValueRunThreadPool(&pool, options, value, taskFn, "", ASYNC_CAN_REQUEST_STOP::NO);
+        launchValue.emplaceValue(1);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    launchValue.wait();
+    QCOMPARE(pool.queueSize("limited"), 1);
+
+    gate.release();
+    value.wait();
+    gateValue.wait();
+}
+
+void TestAsyncValue::telemetry()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    AsyncThreadPool pool(&threadPool);
+
+    std::vector<std::unique_ptr<AsyncValue<int>>> values;
+    for (int i = 0; i < 8; ++i)
+    {
+        values.push_back(std::make_unique<AsyncValue<int>>(AsyncInitByValue(), 0));
+        asyncValueRunThreadPool(&pool, *values.back(), [](AsyncProgress&, AsyncValue<int>& value) {
+            QThread::msleep(10);
+            value.emplaceValue(1);
+        }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    }
+
+    for (auto& value : values)
+        value->wait();
+    threadPool.waitForDone();
+
+    auto telemetry = pool.telemetry();
+    QCOMPARE(telemetry.queueSize, 0);
+    QCOMPARE(telemetry.activeThreads, 0);
+    QCOMPARE(telemetry.completedTasks, quint64(8));
+    QCOMPARE(telemetry.maxThreadCount, 4);
+    QVERIFY(telemetry.taskDuration > 0);
+
+    // idle pool is shrunk to the bounds
+    pool.setAutoTune(1, 2);
+    QTRY_COMPARE(threadPool.maxThreadCount(), 2);
+}
+
+void TestAsyncValue::numaPools()
+{
+    auto pools = AsyncNumaPools::globalInstance();
+    QVERIFY(pools->nodeCount() >= 1);
+
+    AsyncValue<int> value(AsyncInitByValue(), 0);
+
+    auto pool = pools->poolFor(value);
+    asyncValueRunThreadPool(pool, value, [](AsyncProgress&, AsyncValue<int>& value) {
+        value.emplaceValue(1);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    value.wait();
+
+    // follow-up calculations are run on the same node
+    QCOMPARE(pools->poolFor(value), pool);
+}
+
+void TestAsyncValue::checkpoints()
+{
+    AsyncValueRunableFn<int> value(AsyncInitByValue(), 0);
+
+    int stepsDone = 0;
+    int runs = 0;
+
+    value.deferFn = [&value](const AsyncValueRunableFn<int>::RunFnType& fn) {
+        asyncValueRunThreadPool(value, fn, "", ASYNC_CAN_REQUEST_STOP::YES);
+    };
+    value.runFn = [&](AsyncProgressRerun& progress, AsyncValueRunableFn<int>& value) {
+        ++runs;
+
+        int step = 0;
+        progress.loadCheckpoint("input", step);
+
+        for (; step < 10; ++step)
+        {
+            if (step == 5 && runs == 1)
+            {
+                // simulate rerun request in the middle of calculation
+                progress.saveCheckpoint("input", step);
+                progress.requestRerun();
+                return;
+            }
+
+            ++stepsDone;
+        }
+
+        value.emplaceValue(step);
+    };
+
+    value.run();
+    value.wait();
+
+    // second run resumed from the checkpoint
+    QCOMPARE(runs, 2);
+    QCOMPARE(stepsDone, 10);
+
+    // checkpoint with other fingerprint is not used
+    AsyncProgressRerun progress("", ASYNC_CAN_REQUEST_STOP::YES);
+    progress.saveCheckpoint("input", 5);
+    int step = 0;
+    QVERIFY(!progress.loadCheckpoint("other input", step));
+    QVERIFY(progress.loadCheckpoint("input", step));
+    QCOMPARE(step, 5);
+}
+
+void TestAsyncValue::workStats()
+{
+    auto stats = AsyncWorkStats::globalInstance();
+    stats->reset();
+    stats->setEnabled(true);
+
+    SCOPE_EXIT {
+        stats->setEnabled(false);
+        stats->reset();
+    };
+
+    AsyncValueRunableFn<int> value(AsyncInitByValue(), 0);
+
+    int runs = 0;
+    value.deferFn = [&value](const AsyncValueRunableFn<int>::RunFnType& fn) {
+        asyncValueRunThreadPool(value, fn, "", ASYNC_CAN_REQUEST_STOP::YES);
+    };
+    value.runFn = [&runs](AsyncProgressRerun& progress, AsyncValueRunableFn<int>& value) {
+        // first calculation is discarded by rerun
+        if (++runs == 1)
+        {
+            progress.requestRerun();
+            return;
+        }
+
+        value.emplaceValue(1);
+    };
+
+    value.run();
+    value.wait();
+
+    AsyncValue<int> errorValue(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(errorValue, [](AsyncProgress&, AsyncValue<int>& value) {
+        value.emplaceError("error");
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    errorValue.wait();
+
+    QThreadPool::globalInstance()->waitForDone();
+
+    auto group = AsyncWorkStats::group<AsyncValue<int>>();
+    QCOMPARE(stats->totals(group, ASYNC_RUN_OUTCOME::SUPERSEDED).runs, quint64(1));
+    QCOMPARE(stats->totals(group, ASYNC_RUN_OUTCOME::COMPLETED).runs, quint64(1));
+    QCOMPARE(stats->totals(group, ASYNC_RUN_OUTCOME::ERRORED).runs, quint64(1));
+    QVERIFY(stats->toJson().contains(group));
+    QCOMPARE(group, QString("int"));
+
+    // nested run time is not counted by the outer run
+    {
+        AsyncWorkStats::Run outer("outer");
+        {
+            AsyncWorkStats::Run inner("inner");
+            QThread::msleep(50);
+            inner.finish(ASYNC_RUN_OUTCOME::COMPLETED);
+        }
+        outer.finish(ASYNC_RUN_OUTCOME::COMPLETED);
+    }
+    QVERIFY(stats->totals("inner", ASYNC_RUN_OUTCOME::COMPLETED).wallTime >= 50000);
+    QVERIFY(stats->totals("outer", ASYNC_RUN_OUTCOME::COMPLETED).wallTime < 50000);
+}
+
+void TestAsyncValue::prefetchCache()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    AsyncPrefetchCache<int, AsyncValue<int>> cache(4, [](const int& key, AsyncProgress& progress, AsyncValue<int>& value) {
+        // long calculation for keys from 4
+        while (key >= 4 && !progress.isStopRequested())
+            QThread::msleep(10);
+
+        value.emplaceValue(key * 2);
+    }, &pool);
+
+    // predicted value is calculated in advance
+    QVERIFY(cache.prefetch(1));
+    threadPool.waitForDone();
+
+    auto value = cache.get(1);
+    int result = 0;
+    value->wait([&result](const int& v) {
+        result = v;
+    }, AsyncNoOp());
+    QCOMPARE(result, 2);
+
+    // long prefetch occupies the only thread
+    QVERIFY(cache.prefetch(4));
+    auto prefetched = cache.get(4);
+
+    // no prefetches when pool is busy
+    QTRY_COMPARE(pool.telemetry().idleThreads, 0);
+    QVERIFY(!cache.prefetch(2));
+    QVERIFY(!cache.contains(2));
+
+    // requested value is not cancelled
+    cache.cancelPrefetches();
+    QVERIFY(cache.contains(4));
+
+    prefetched->accessProgress([](AsyncProgress& progress) {
+        progress.requestStop();
+    });
+    prefetched->wait();
+
+    // requested value cancels outstanding prefetches when pool is busy
+    QTRY_COMPARE(pool.telemetry().idleThreads, 1);
+    QVERIFY(cache.prefetch(5));
+    QTRY_COMPARE(pool.telemetry().idleThreads, 0);
+    auto requested = cache.get(3);
+    QVERIFY(!cache.contains(5));
+
+    requested->wait([&result](const int& v) {
+        result = v;
+    }, AsyncNoOp());
+    QCOMPARE(result, 6);
+}
+
+void TestAsyncValue::startupLoader()
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(1);
+    AsyncThreadPool pool(&threadPool);
+
+    AsyncValue<int> hidden(AsyncInitByError(), "not loaded");
+    AsyncValue<int> header(AsyncInitByError(), "not loaded");
+    AsyncValue<int> content(AsyncInitByError(), "not loaded");
+
+    QMutex lock;
+    std::vector<int> loaded;
+    auto load = [&lock, &loaded](int visibility) {
+        return [&lock, &loaded, visibility](AsyncProgress&, AsyncValue<int>& value) {
+            QMutexLocker locker(&lock);
+            loaded.push_back(visibility);
+            value.emplaceValue(visibility);
+        };
+    };
+
+    AsyncStartupLoader loader(&pool);
+    loader.add(hidden, 0, load(0), false);
+    loader.add(content, 5, load(5));
+    loader.add(header, 10, load(10));
+
+    std::atomic<int> firstScreenReady(0);
+    std::atomic<int> finished(0);
+    QObject::connect(&loader, &AsyncStartupLoader::firstScreenReady, [&firstScreenReady](){
+        ++firstScreenReady;
+    });
+    QObject::connect(&loader, &AsyncStartupLoader::finished, [&finished](){
+        ++finished;
+    });
+
+    QVERIFY(!loader.isFirstScreenReady());
+    loader.start();
+    loader.wait();
+
+    // most visible values are loaded first
+    QCOMPARE(loaded, std::vector<int>({10, 5, 0}));
+    QVERIFY(loader.isFirstScreenReady());
+    QCOMPARE(firstScreenReady.load(), 1);
+    QCOMPARE(finished.load(), 1);
+    QVERIFY(header.accessValue([](const int& value) {
+        QCOMPARE(value, 10);
+    }));
+
+    // value already in progress is waited for
+    {
+        QThreadPool otherThreadPool;
+        AsyncThreadPool otherPool(&otherThreadPool);
+
+        QSemaphore gate;
+        AsyncValue<int> busy(AsyncInitByError(), "not loaded");
+        asyncValueRunThreadPool(&otherPool, busy, [&gate](AsyncProgress&, AsyncValue<int>& value) {
+            gate.acquire();
+            value.emplaceValue(1);
+        }, "", ASYNC_CAN_REQUEST_STOP::NO);
+
+        AsyncStartupLoader busyLoader(&pool);
+        busyLoader.add(busy, 0, load(0));
+        busyLoader.start();
+
+        QThread::msleep(50);
+        QVERIFY(!busyLoader.isFirstScreenReady());
+
+        gate.release();
+        busyLoader.wait();
+        QVERIFY(busyLoader.isFirstScreenReady());
+        QVERIFY(busy.accessValue([](const int& value) {
+            QCOMPARE(value, 1);
+        }));
+    }
+}
+
+void TestAsyncValue::coldStorage()
+{
+    QByteArray data(1024 * 1024, 'a');
+    AsyncValue<QByteArray> value(AsyncInitByValue(), data);
+
+    AsyncColdStorage storage(50);
+    storage.add(value);
+
+    // idle value is compressed in the background
+    QTRY_VERIFY(value.isValueEvicted());
+
+    // and decompressed on access
+    QVERIFY(value.accessValue([&data](const QByteArray& content) {
+        QCOMPARE(content, data);
+    }));
+    QVERIFY(!value.isValueEvicted());
+
+    // shared value is not compressed
+    auto shared = value.sharedValue();
+    QThread::msleep(100);
+    QCOMPARE(storage.compressIdleValues(), 0);
+    shared.reset();
+
+    QTRY_VERIFY(value.isValueEvicted());
+    storage.remove(value);
+    QVERIFY(!value.isValueEvicted());
+
+    // value that cannot be restored gets error
+    storage.setCodec([](const QByteArray& data) { return qCompress(data); }, [](const QByteArray&) { return QByteArray(); });
+    storage.add(value);
+    QTRY_VERIFY(value.isValueEvicted());
+
+    // and observers are notified
+    std::vector<ASYNC_VALUE_STATE> states;
+    auto connection = QObject::connect(&value, &AsyncValueBase::stateChanged, [&states](ASYNC_VALUE_STATE state){
+        states.push_back(state);
+    });
+    QVERIFY(!value.accessValue([](const QByteArray&) {}));
+    QVERIFY(value.isErrorAssigned());
+    QCOMPARE(states, std::vector<ASYNC_VALUE_STATE>({ASYNC_VALUE_STATE::ERROR}));
+    QVERIFY(value.accessError([](const AsyncError&) {}));
+    QObject::disconnect(connection);
+    storage.remove(value);
+
+    // values not used with cold storage don't need QString errors
+    AsyncValueTemplate<int, int, AsyncProgress> plainValue(AsyncInitByValue(), 1);
+    plainValue.wait();
+    QVERIFY(plainValue.modifyValue([](int& value) {
+        value = 2;
+    }));
+    QVERIFY(plainValue.accessValue([](int value) {
+        QCOMPARE(value, 2);
+    }));
+}
+
+void TestAsyncValue::spillFile()
+{
+    QByteArray data(1024 * 1024, 'a');
+    AsyncValue<QByteArray> value(AsyncInitByValue(), data);
+
+    auto file = std::make_shared<AsyncSpillFile>();
+    QVERIFY(file->isOpen());
+
+    AsyncColdStorage storage(50);
+    storage.setSpillFile(file, 50);
+    storage.add(value);
+
+    // compressed value goes to disk
+    QTRY_COMPARE(file->recordCount(), 1);
+    QVERIFY(value.isValueEvicted());
+
+    // and is read back without recalculation
+    QVERIFY(value.accessValue([&data](const QByteArray& content) {
+        QCOMPARE(content, data);
+    }));
+    QCOMPARE(file->recordCount(), 0);
+    QCOMPARE(file->size(), qint64(0));
+
+    storage.remove(value);
+
+    // space of removed records is reused
+    auto first = file->write(QByteArray(100, 'b'));
+    auto second = file->write(QByteArray(100, 'c'));
+    file->remove(first);
+    QCOMPARE(file->garbageSize(), qint64(100));
+
+    auto third = file->write(QByteArray(60, 'd'));
+    QCOMPARE(file->size(), qint64(200));
+    QCOMPARE(file->garbageSize(), qint64(40));
+    QCOMPARE(file->read(second), QByteArray(100, 'c'));
+    QCOMPARE(file->read(third), QByteArray(60, 'd'));
+
+    // and free tail is truncated
+    file->remove(second);
+    QCOMPARE(file->size(), qint64(60));
+    QCOMPARE(file->garbageSize(), qint64(0));
+    file->remove(third);
+    QCOMPARE(file->size(), qint64(0));
+}
+
+void TestAsyncValue::emitProfiler()
+{
+    AsyncValue<int> fast(AsyncInitByValue(), 0);
+    AsyncValue<int> slow(AsyncInitByValue(), 0);
+    slow.setObjectName("slow");
+
+    QObject::connect(&slow, &AsyncValueBase::stateChanged, [](ASYNC_VALUE_STATE){
+        QThread::msleep(20);
+    });
+
+    auto profiler = AsyncEmitProfiler::globalInstance();
+    profiler->reset();
+    profiler->setThreshold(10000);
+    profiler->setEnabled(true);
+    SCOPE_EXIT {
+        profiler->setEnabled(false);
+        profiler->setThreshold(ASYNC_SLOW_EMIT_THRESHOLD_USEC);
+        profiler->reset();
+    };
+
+    fast.emplaceValue(1);
+    slow.emplaceValue(1);
+
+    QCOMPARE(profiler->emits(), quint64(2));
+
+    // only slow handler is reported
+    auto slowEmits = profiler->slowEmits();
+    QCOMPARE(slowEmits.size(), size_t(1));
+    QCOMPARE(slowEmits.front().value, QString("slow"));
+    QCOMPARE(slowEmits.front().receivers, 1);
+    QVERIFY(slowEmits.front().duration >= 10000);
+}
+
+void TestAsyncValue::blockingDetector()
+{
+    AsyncValue<int> value(AsyncInitByValue(), 0);
+    value.setObjectName("blocking");
+
+    // slow handler holds write lock in the worker thread
+    QSemaphore handlerStarted;
+    auto mainThread = QThread::currentThread();
+    QObject::connect(&value, &AsyncValueBase::stateChanged, [&handlerStarted, mainThread](ASYNC_VALUE_STATE){
+        if (QThread::currentThread() == mainThread)
+            return;
+
+        handlerStarted.release();
+        QThread::msleep(100);
+    });
+
+    auto detector = AsyncBlockingDetector::globalInstance();
+    detector->reset();
+    detector->setThreshold(20);
+    detector->setEnabled(true);
+    SCOPE_EXIT {
+        detector->setEnabled(false);
+        detector->setThreshold(ASYNC_GUI_BLOCKING_THRESHOLD_MSEC);
+        detector->reset();
+    };
+
+    QThreadPool pool;
+    QtConcurrent::run(&pool, [&value]() {
+        value.emplaceValue(1);
+    });
+
+    // GUI thread is blocked by the worker
+    handlerStarted.acquire();
+    {
+        ASYNC_BLOCKING_SITE();
+        value.emplaceValue(2);
+    }
+    pool.waitForDone();
+
+    // not blocked calls are not reported
+    value.accessValue(AsyncNoOp());
+
+    auto blockings = detector->blockings();
+    QCOMPARE(blockings.size(), size_t(1));
+    QCOMPARE(blockings.front().value, QString("blocking"));
+    QCOMPARE(blockings.front().api, QString("shareValue"));
+    QVERIFY(blockings.front().site.contains("TestAsyncValue.cpp:"));
+    QVERIFY(blockings.front().owner != 0);
+    QVERIFY(blockings.front().duration >= 20);
+
+    // waiting reports the thread calculating the value
+    detector->reset();
+    AsyncValue<int> calculated(AsyncInitByValue(), 0);
+    asyncValueRunThreadPool(&pool, calculated, [](AsyncProgress&, AsyncValue<int>& value) {
+        QThread::msleep(100);
+        value.emplaceValue(1);
+    }, "", ASYNC_CAN_REQUEST_STOP::NO);
+    calculated.wait();
+    pool.waitForDone();
+
+    blockings = detector->blockings();
+    auto waitIt = std::find_if(blockings.begin(), blockings.end(), [](const AsyncBlockingDetector::Blocking& blocking) {
+        return blocking.api == "wait";
+    });
+    QVERIFY(waitIt != blockings.end());
+    QVERIFY(waitIt->owner != 0);
+    QVERIFY(waitIt->site.isEmpty());
+
+    // restore of evicted value in GUI thread is measured
+    detector->reset();
+    AsyncValue<QByteArray> evicted(AsyncInitByValue(), QByteArray(1024 * 1024, 'a'));
+    AsyncColdStorage storage(50);
+    storage.setCodec([](const QByteArray& data) { return qCompress(data); }, [](const QByteArray& data) {
+        QThread::msleep(50);
+        return qUncompress(data);
+    });
+    storage.add(evicted);
+    QTRY_VERIFY(evicted.isValueEvicted());
+    {
+        ASYNC_BLOCKING_SITE();
+        QVERIFY(evicted.accessValue(AsyncNoOp()));
+    }
+    storage.remove(evicted);
+
+    blockings = detector->blockings();
+    QCOMPARE(blockings.size(), size_t(1));
+    QCOMPARE(blockings.front().api, QString("restoreValue"));
+    QVERIFY(blockings.front().site.contains("TestAsyncValue.cpp:"));
+}
+
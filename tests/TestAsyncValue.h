@@ -16,9 +16,34 @@ private Q_SLOTS:
     void runInThread();
     void runInThreadPool();
     void catchDeadlock();
+    void deferredMutation();
     void wait();
     void run();
     void network();
+    void transaction();
+    void multicast();
+    void projection();
+    void skipEqualValues();
+    void modifyValue();
+    void recycleValues();
+    void taskScope();
+    void helpWhileWaiting();
+    void priorityInheritance();
+    void deadline();
+    void categoryLimit();
+    void boundedQueue();
+    void blockingWorkers();
+    void adaptiveExecution();
+    void telemetry();
+    void numaPools();
+    void checkpoints();
+    void workStats();
+    void prefetchCache();
+    void startupLoader();
+    void coldStorage();
+    void spillFile();
+    void emitProfiler();
+    void blockingDetector();
 };
 
 #endif // TEST_ASYNC_VALUE_H